@@ -0,0 +1,76 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+// append only storage shared by threads, elements never move
+// every thread claims its own blocks of ids and fills them without locking
+template<typename T>
+class SharedArena {
+private:
+    static const uint32_t CHUNK_BITS = 16;
+    static const uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    // up to 2^30 elements
+    static const uint32_t MAX_CHUNKS = 1u << 14;
+
+    std::atomic<T*>* chunks;
+    std::atomic<uint32_t> claimed;
+    std::mutex grow_mutex;
+
+public:
+    SharedArena() {
+        chunks = new std::atomic<T*>[MAX_CHUNKS];
+        for(uint32_t i = 0; i < MAX_CHUNKS; i++)
+            chunks[i] = nullptr;
+        claimed = 0;
+    }
+
+    ~SharedArena() {
+        for(uint32_t i = 0; i < MAX_CHUNKS; i++)
+            delete[] chunks[i].load();
+        delete[] chunks;
+    }
+
+    SharedArena(const SharedArena&) = delete;
+    SharedArena& operator=(const SharedArena&) = delete;
+
+    // first id of count new elements in a row
+    uint32_t claim(uint32_t count) {
+        uint32_t first = claimed.fetch_add(count);
+        claim_at(first, count);
+        return first;
+    }
+
+    // makes room for ids claimed from another arena, so arenas of one structure of arrays share ids
+    void claim_at(uint32_t first, uint32_t count) {
+        if((uint64_t)first + count > (uint64_t)MAX_CHUNKS * CHUNK_SIZE)
+            abort();
+
+        for(uint32_t chunk = first >> CHUNK_BITS; count > 0 && chunk <= (first + count - 1) >> CHUNK_BITS; chunk++) {
+            if(chunks[chunk].load(std::memory_order_acquire) != nullptr)
+                continue;
+            std::lock_guard<std::mutex> lock(grow_mutex);
+            if(chunks[chunk].load(std::memory_order_relaxed) == nullptr)
+                chunks[chunk].store(new T[CHUNK_SIZE], std::memory_order_release);
+        }
+    }
+
+    // ids reach this thread through task hand off, which orders the chunk allocation before it
+    T& operator[](uint32_t id) {
+        return chunks[id >> CHUNK_BITS].load(std::memory_order_relaxed)[id & (CHUNK_SIZE - 1)];
+    }
+
+    const T& operator[](uint32_t id) const {
+        return chunks[id >> CHUNK_BITS].load(std::memory_order_relaxed)[id & (CHUNK_SIZE - 1)];
+    }
+
+    // claimed ids, some may be unused ends of blocks
+    uint32_t size() const {
+        return claimed;
+    }
+};
+
+#endif
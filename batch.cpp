@@ -0,0 +1,86 @@
+#include "include/raylib.h"
+#include "include/rlgl.h"
+#include <algorithm>
+#include "batch.hpp"
+
+// triangles per rlBegin/rlEnd, well below raylib default batch buffer
+const size_t BATCH_CHUNK_TRIANGLES = 2048;
+
+TriangleBatch::TriangleBatch(size_t capacity) {
+    reserve(capacity);
+}
+
+void TriangleBatch::reserve(size_t capacity) {
+    verticies.reserve(capacity * 3);
+    colors.reserve(capacity);
+}
+
+// keeps memory for the next frame
+void TriangleBatch::clear() {
+    verticies.clear();
+    colors.clear();
+    depths.clear();
+}
+
+// stored in counter clockwise order
+void TriangleBatch::add(Vector2 v1, Vector2 v2, Vector2 v3, Color color) {
+    // raylib wants counter clockwise order on screen, y axis points down
+    float area = (v2.x - v1.x) * (v3.y - v1.y) - (v2.y - v1.y) * (v3.x - v1.x);
+    if(area >= 0)
+        std::swap(v1, v3);
+
+    verticies.push_back(v1);
+    verticies.push_back(v2);
+    verticies.push_back(v3);
+    colors.push_back(color);
+}
+
+// screen x, y and ndc z, for depth tested targets
+void TriangleBatch::add(Vector3 v1, Vector3 v2, Vector3 v3, Color color) {
+    float area = (v2.x - v1.x) * (v3.y - v1.y) - (v2.y - v1.y) * (v3.x - v1.x);
+    if(area >= 0)
+        std::swap(v1, v3);
+
+    verticies.push_back((Vector2){v1.x, v1.y});
+    verticies.push_back((Vector2){v2.x, v2.y});
+    verticies.push_back((Vector2){v3.x, v3.y});
+    depths.push_back(v1.z);
+    depths.push_back(v2.z);
+    depths.push_back(v3.z);
+    colors.push_back(color);
+}
+
+void TriangleBatch::submit() const {
+    size_t count = colors.size();
+    for(size_t first = 0; first < count; first += BATCH_CHUNK_TRIANGLES) {
+        size_t last = std::min(count, first + BATCH_CHUNK_TRIANGLES);
+
+        // flushes raylib batch only when this chunk would not fit
+        rlCheckRenderBatchLimit((last - first) * 3);
+        rlBegin(RL_TRIANGLES);
+        for(size_t i = first; i < last; i++) {
+            const Color& c = colors[i];
+            rlColor4ub(c.r, c.g, c.b, c.a);
+            rlVertex2f(verticies[3*i].x, verticies[3*i].y);
+            rlVertex2f(verticies[3*i + 1].x, verticies[3*i + 1].y);
+            rlVertex2f(verticies[3*i + 2].x, verticies[3*i + 2].y);
+        }
+        rlEnd();
+    }
+}
+
+size_t TriangleBatch::size() const {
+    return colors.size();
+}
+
+const std::vector<Vector2>& TriangleBatch::get_verticies() const {
+    return verticies;
+}
+
+const std::vector<Color>& TriangleBatch::get_colors() const {
+    return colors;
+}
+
+const std::vector<float>& TriangleBatch::get_depths() const {
+    return depths;
+}
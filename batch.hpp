@@ -0,0 +1,45 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "include/raylib.h"
+#include <vector>
+
+// screen space triangles in draw order, drawn together by a render target
+class TriangleBatch {
+private:
+    std::vector<Vector2> verticies;
+    std::vector<Color> colors;
+    // ndc z of every vertex, empty unless triangles came with depth
+    std::vector<float> depths;
+
+public:
+    TriangleBatch(size_t capacity = 0);
+
+    void reserve(size_t capacity);
+
+    // keeps memory for the next frame
+    void clear();
+
+    // stored in counter clockwise order
+    void add(Vector2 v1, Vector2 v2, Vector2 v3, Color color);
+
+    // screen x, y and ndc z, for depth tested targets
+    // a batch uses either this or the 2d add, not both
+    void add(Vector3 v1, Vector3 v2, Vector3 v3, Color color);
+
+    // sends triangles through raylib, needs open window
+    void submit() const;
+
+    size_t size() const;
+
+    // three verticies per triangle
+    const std::vector<Vector2>& get_verticies() const;
+
+    // one color per triangle
+    const std::vector<Color>& get_colors() const;
+
+    // one per vertex, empty for 2d batches
+    const std::vector<float>& get_depths() const;
+};
+
+#endif
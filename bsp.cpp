@@ -1,23 +1,198 @@
 #include "include/raylib.h"
 #include "include/raymath.h"
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <unordered_map>
 #include "util.hpp"
 #include "bsp.hpp"
+#include "arena.hpp"
+#include "threads.hpp"
+#include "counters.hpp"
 
-BSPNode::BSPNode(Triangle* triangle) {
-    this->triangle = triangle;
-    this->point_on_triangle = triangle->verticies[0];
-    this->behind = NULL;
-    this->front = NULL;
+// triangles drawn before first coverage update in front to back mode
+const size_t FRONT_TO_BACK_FIRST_CHUNK = 64;
 
-    auto v1 = Vector3Subtract(triangle->verticies[0], triangle->verticies[1]);
-    auto v2 = Vector3Subtract(triangle->verticies[0], triangle->verticies[2]);
-    this->triangle_normal = Vector3CrossProduct(v1, v2);
+// marks dynamic triangles in draw list
+const uint32_t DYNAMIC_DRAW_BIT = 1u << 31;
+// draw stack entries, node index when no bit is set
+const uint32_t DRAW_NODE_BIT = 1u << 31;
+const uint32_t DRAW_BUCKET_BIT = 1u << 30;
+
+BSPNode::BSPNode(Vector4 plane) {
+    this->plane = plane;
+    this->behind = BSP_NO_NODE;
+    this->front = BSP_NO_NODE;
+    this->bounds_min = (Vector3){0.0f, 0.0f, 0.0f};
+    this->bounds_max = (Vector3){0.0f, 0.0f, 0.0f};
 }
 
 bool BSPNode::camera_in_front(const Vcam& camera) const {
-    auto camera_vector = Vector3Subtract(camera.get_pos(), point_on_triangle);
-    return Vector3DotProduct(camera_vector, triangle_normal) > 0 ? true : false;
+    return point_in_plane_equasion(camera.get_pos(), plane) > 0;
+}
+
+// node while building, children are ids in node arena
+struct BuildNode {
+    Vector4 plane;
+    uint32_t behind;
+    uint32_t front;
+    uint32_t triangle;
+};
+
+// ids claimed at once by every build thread
+const uint32_t BUILD_ARENA_BLOCK = 1024;
+
+// per thread build state, ids come from the shared arenas in blocks
+struct BuildThread {
+    uint32_t next_vertex = 0, end_vertex = 0;
+    uint32_t next_triangle = 0, end_triangle = 0;
+    uint32_t next_node = 0, end_node = 0;
+    // intersection vertex of each edge split by current node
+    std::unordered_map<uint64_t, uint32_t> edge_cache;
+    // corners of classified triangles and their side flags, 3 per triangle
+    std::vector<float> corner_x, corner_y, corner_z;
+    std::vector<uint8_t> corner_sides;
+    int split_count = 0;
+    int node_count = 0;
+    int depth = 0;
+};
+
+// vertex ids of triangle while building
+struct BuildTriangle {
+    uint32_t v[3];
+};
+
+// build time state shared by build threads
+// triangles are a structure of arrays, id i is the same triangle in every triangle arena
+// so classification loads only indices and verticies, planes are computed once per triangle
+// verticies are gathered by index, their coordinates stay together
+// planes are normalized when plane thickness is set, so it is a distance
+// exact classification keeps them as computed, normalizing rounds coplanar pieces off each other's planes
+struct BSPTree::BuildContext {
+    ThreadPool pool;
+    SharedArena<Vector3> verticies;
+    SharedArena<BuildTriangle> triangles;
+    SharedArena<Vector4> planes;
+    SharedArena<Color> colors;
+    SharedArena<uint8_t> flags;
+    SharedArena<BuildNode> nodes;
+    std::vector<BuildThread> threads;
+    bool normalize_planes;
+
+    BuildContext(int thread_count, bool normalize_planes) : pool(thread_count), threads(pool.size()), normalize_planes(normalize_planes) {}
+
+    BuildThread& thread() {
+        return threads[pool.thread_index()];
+    }
+
+    // first id of count triangles, triangles arena hands out the ids
+    uint32_t claim_triangles(uint32_t count) {
+        uint32_t first = triangles.claim(count);
+        planes.claim_at(first, count);
+        colors.claim_at(first, count);
+        flags.claim_at(first, count);
+        return first;
+    }
+
+    const Vector3& vertex(uint32_t v) {
+        return verticies[v];
+    }
+
+    Vector4 plane_of(Vector4 plane) {
+        return normalize_planes ? normalize_plane(plane) : plane;
+    }
+
+    Vector4 plane_of(uint32_t v1, uint32_t v2, uint32_t v3) {
+        return plane_of(points_to_plane(vertex(v1), vertex(v2), vertex(v3)));
+    }
+
+    void set_triangle(uint32_t triangle, uint32_t v1, uint32_t v2, uint32_t v3) {
+        triangles[triangle] = (BuildTriangle){{v1, v2, v3}};
+        planes[triangle] = plane_of(v1, v2, v3);
+    }
+
+    uint32_t add_vertex(Vector3 vertex) {
+        BuildThread& t = thread();
+        if(t.next_vertex == t.end_vertex) {
+            t.next_vertex = verticies.claim(BUILD_ARENA_BLOCK);
+            t.end_vertex = t.next_vertex + BUILD_ARENA_BLOCK;
+        }
+        verticies[t.next_vertex] = vertex;
+        return t.next_vertex++;
+    }
+
+    // piece of a split triangle, keeps its color and flags
+    // plane comes from the piece verticies, they are off the split triangle plane by rounding
+    uint32_t add_piece(uint32_t of, uint32_t v1, uint32_t v2, uint32_t v3) {
+        BuildThread& t = thread();
+        if(t.next_triangle == t.end_triangle) {
+            t.next_triangle = claim_triangles(BUILD_ARENA_BLOCK);
+            t.end_triangle = t.next_triangle + BUILD_ARENA_BLOCK;
+        }
+        triangles[t.next_triangle] = (BuildTriangle){{v1, v2, v3}};
+        planes[t.next_triangle] = plane_of(v1, v2, v3);
+        colors[t.next_triangle] = colors[of];
+        flags[t.next_triangle] = flags[of];
+        return t.next_triangle++;
+    }
+
+    uint32_t add_node(uint32_t triangle, int depth) {
+        BuildThread& t = thread();
+        if(t.next_node == t.end_node) {
+            t.next_node = nodes.claim(BUILD_ARENA_BLOCK);
+            t.end_node = t.next_node + BUILD_ARENA_BLOCK;
+        }
+        t.node_count++;
+        t.depth = std::max(t.depth, depth);
+        nodes[t.next_node] = (BuildNode){planes[triangle], BSP_NO_NODE, BSP_NO_NODE, triangle};
+        return t.next_node++;
+    }
+
+    // corners of triangles into thread arrays, gathered once for every plane they are classified against
+    VertexArrays gather_corners(const std::vector<uint32_t>& triangle_list) {
+        BuildThread& t = thread();
+        size_t count = triangle_list.size() * 3;
+        t.corner_x.resize(count);
+        t.corner_y.resize(count);
+        t.corner_z.resize(count);
+        t.corner_sides.resize(count);
+        for(size_t i = 0; i < triangle_list.size(); i++) {
+            const uint32_t* v = triangles[triangle_list[i]].v;
+            for(int j = 0; j < 3; j++) {
+                const Vector3& p = vertex(v[j]);
+                t.corner_x[3 * i + j] = p.x;
+                t.corner_y[3 * i + j] = p.y;
+                t.corner_z[3 * i + j] = p.z;
+            }
+        }
+        return (VertexArrays){t.corner_x.data(), t.corner_y.data(), t.corner_z.data(), count};
+    }
+};
+
+// which side of plane is triangle with these corner flags on
+// 1 if in front or on plane, 0 if it crosses, -1 if behind
+static int triangle_side(const uint8_t* sides) {
+    uint8_t flags = sides[0] | sides[1] | sides[2];
+    if(flags == (PLANE_FRONT | PLANE_BEHIND))
+        return 0;
+    return flags == PLANE_BEHIND ? -1 : 1;
+}
+
+// triangles below this count build their subtree on one thread
+const size_t PARALLEL_BUILD_CUTOFF = 2048;
+
+bool BSPTree::is_axis_aligned(BuildContext& build, uint32_t triangle) const {
+    Vector4 plane = build.planes[triangle];
+    Vector3 normal = Vector3Normalize((Vector3){plane.x, plane.y, plane.z});
+    float eps = 1e-4f;
+    return fabsf(fabsf(normal.x) - 1.0f) < eps ||
+        fabsf(fabsf(normal.y) - 1.0f) < eps ||
+        fabsf(fabsf(normal.z) - 1.0f) < eps;
 }
 
 int BSPTree::line_intersection_with_plane(Vector3 p1, Vector3 p2, Vector4 plane, Vector3* out_point) const {
@@ -29,6 +204,8 @@ int BSPTree::line_intersection_with_plane(Vector3 p1, Vector3 p2, Vector4 plane,
         return -1;
 
     float param = -((plane.x * p1.x + plane.y * p1.y + plane.z * p1.z + plane.w) / denominator);
+    // rounding on nearly parallel edges can put the point outside of the edge
+    param = Clamp(param, 0.0f, 1.0f);
 
     float intersection_x = p1.x + param * (p2.x - p1.x);
     float intersection_y = p1.y + param * (p2.y - p1.y);
@@ -38,175 +215,1413 @@ int BSPTree::line_intersection_with_plane(Vector3 p1, Vector3 p2, Vector4 plane,
     return 0;
 }
 
-// split triangle using plane
-void BSPTree::split(Triangle* triangle, Vector4 plane, std::vector<Triangle*>& triangles) {
-    triangles.erase(std::remove(triangles.begin(), triangles.end(), triangle), triangles.end());
-    Triangle t = triangle->copy();
-    delete triangle;
+// vertex where plane crosses edge, shared by triangles on both sides of the edge
+int BSPTree::edge_intersection(BuildContext& build, uint32_t v1, uint32_t v2, const Vector4& plane, uint32_t* out_vertex) const {
+    // same point whichever way the edge is walked
+    if(v1 > v2)
+        std::swap(v1, v2);
+    uint64_t key = ((uint64_t)v1 << 32) | v2;
+    auto& edge_cache = build.thread().edge_cache;
+    auto cached = edge_cache.find(key);
+    if(cached != edge_cache.end()) {
+        *out_vertex = cached->second;
+        return 0;
+    }
 
-    float sign_p1 = point_in_plane_equasion(t.verticies[0], plane);
-    float sign_p2 = point_in_plane_equasion(t.verticies[1], plane);
-    float sign_p3 = point_in_plane_equasion(t.verticies[2], plane);
+    Vector3 point;
+    if(line_intersection_with_plane(build.vertex(v1), build.vertex(v2), plane, &point) < 0)
+        return -1;
+    *out_vertex = build.add_vertex(point);
+    edge_cache[key] = *out_vertex;
+    return 0;
+}
 
-    Vector3 one_side;
-    Vector3 other_side1;
-    Vector3 other_side2;
-    Vector3 intersection1;
-    Vector3 intersection2;
+// split triangle using plane, pieces go to the bucket on their side
+// sides are classify_verticies flags of the triangle corners
+void BSPTree::split(BuildContext& build, uint32_t triangle, const Vector4& plane, const uint8_t* sides, std::vector<uint32_t>& front_triangles, std::vector<uint32_t>& behind_triangles) const {
+    BuildTriangle t = build.triangles[triangle];
 
-    // split on 2 triangles
-    if(sign_p1 == 0) {
-        if(line_intersection_with_plane(t.verticies[1], t.verticies[2], plane, &intersection1) < 0)
+    // pieces keep vertex order of split triangle so their planes face the same way
+    // first piece reuses the entry of split triangle
+    // split on 2 triangles, vertex on plane is shared
+    int on_plane = sides[0] == 0 ? 0 : sides[1] == 0 ? 1 : sides[2] == 0 ? 2 : -1;
+    if(on_plane >= 0) {
+        int a = (on_plane + 1) % 3;
+        int b = (on_plane + 2) % 3;
+        uint32_t intersection;
+        if(edge_intersection(build, t.v[a], t.v[b], plane, &intersection) < 0) {
+            front_triangles.push_back(triangle);
             return;
-        Triangle* t1new = new Triangle(t.verticies[0], intersection1, t.verticies[1], t.color);
-        Triangle* t2new = new Triangle(t.verticies[0], intersection1, t.verticies[2], t.color);
-        triangles.push_back(t1new);
-        triangles.push_back(t2new);
+        }
+        build.set_triangle(triangle, t.v[on_plane], t.v[a], intersection);
+        uint32_t t2new = build.add_piece(triangle, t.v[on_plane], intersection, t.v[b]);
+        (sides[a] == PLANE_FRONT ? front_triangles : behind_triangles).push_back(triangle);
+        (sides[b] == PLANE_FRONT ? front_triangles : behind_triangles).push_back(t2new);
+        build.thread().split_count++;
         return;
     }
-    if(sign_p2 == 0) {
-        if(line_intersection_with_plane(t.verticies[0], t.verticies[2], plane, &intersection1) < 0)
-            return;
-        Triangle* t1new = new Triangle(t.verticies[1], intersection1, t.verticies[0], t.color);
-        Triangle* t2new = new Triangle(t.verticies[1], intersection1, t.verticies[2], t.color);
-        triangles.push_back(t1new);
-        triangles.push_back(t2new);
+
+    // split on 3 triangles, vertex one_side is alone on its side
+    int k = sides[0] == sides[1] ? 2 : sides[1] == sides[2] ? 0 : 1;
+    uint32_t one_side = t.v[k];
+    uint32_t other_side1 = t.v[(k + 1) % 3];
+    uint32_t other_side2 = t.v[(k + 2) % 3];
+    uint32_t intersection1;
+    uint32_t intersection2;
+
+    if(edge_intersection(build, one_side, other_side1, plane, &intersection1) ||
+        edge_intersection(build, one_side, other_side2, plane, &intersection2)) {
+        front_triangles.push_back(triangle);
         return;
     }
-    if(sign_p3 == 0) {
-        if(line_intersection_with_plane(t.verticies[0], t.verticies[1], plane, &intersection1) < 0)
-            return;
-        Triangle* t1new = new Triangle(t.verticies[2], intersection1, t.verticies[0], t.color);
-        Triangle* t2new = new Triangle(t.verticies[2], intersection1, t.verticies[1], t.color);
-        triangles.push_back(t1new);
-        triangles.push_back(t2new);
+
+    build.set_triangle(triangle, one_side, intersection1, intersection2);
+    uint32_t t2new = build.add_piece(triangle, intersection1, other_side1, other_side2);
+    uint32_t t3new = build.add_piece(triangle, intersection1, other_side2, intersection2);
+
+    auto& one_side_triangles = sides[k] == PLANE_FRONT ? front_triangles : behind_triangles;
+    auto& other_side_triangles = sides[k] == PLANE_FRONT ? behind_triangles : front_triangles;
+    one_side_triangles.push_back(triangle);
+    other_side_triangles.push_back(t2new);
+    other_side_triangles.push_back(t3new);
+    build.thread().split_count++;
+}
+
+// classify every triangle once, triangles keeps the behind bucket
+void BSPTree::partition(BuildContext& build, const Vector4& plane, std::vector<uint32_t>& triangles, std::vector<uint32_t>& front_triangles) const {
+    std::vector<uint32_t> split_behind;
+    auto& edge_cache = build.thread().edge_cache;
+    if(!edge_cache.empty())
+        edge_cache.clear();
+
+    // split adds verticies to the arena, corner flags stay valid as they are copies
+    VertexArrays corners = build.gather_corners(triangles);
+    uint8_t* sides = build.thread().corner_sides.data();
+    classify_verticies(plane, plane_thickness, corners, sides);
+
+    size_t behind_count = 0;
+    size_t count = triangles.size();
+    for(size_t i = 0; i < count; i++) {
+        auto t = triangles[i];
+        auto test_result = triangle_side(sides + 3 * i);
+        if(test_result == -1)
+            triangles[behind_count++] = t;
+        else if(test_result == 1)
+            front_triangles.push_back(t);
+        else
+            split(build, t, plane, sides + 3 * i, front_triangles, split_behind);
+    }
+
+    triangles.resize(behind_count);
+    triangles.insert(triangles.end(), split_behind.begin(), split_behind.end());
+}
+
+// lower is better, splits weigh more than front/behind imbalance
+// corners are gathered verticies of triangles, 3 per triangle
+int BSPTree::splitter_score(BuildContext& build, uint32_t splitter, const std::vector<uint32_t>& triangles, const VertexArrays& corners) const {
+    uint8_t* sides = build.thread().corner_sides.data();
+    classify_verticies(build.planes[splitter], plane_thickness, corners, sides);
+    int front = 0, behind = 0, crossing = 0;
+    for(size_t i = 0; i < triangles.size(); i++) {
+        if(triangles[i] == splitter)
+            continue;
+        auto test_result = triangle_side(sides + 3 * i);
+        if(test_result == 1)
+            front++;
+        else if(test_result == -1)
+            behind++;
+        else
+            crossing++;
+    }
+
+    return 8 * crossing + abs(front - behind);
+}
+
+// move chosen splitter to the back of the list
+void BSPTree::choose_splitter(BuildContext& build, std::vector<uint32_t>& triangles) const {
+    if(triangles.size() <= 1)
+        return;
+    if(strategy == SplitterStrategy::FIRST) {
+        std::swap(triangles.front(), triangles.back());
         return;
     }
-    // split on 3 triangles
-    else if((sign_p1 > 0 && sign_p2 > 0) || (sign_p1 < 0 && sign_p2 < 0)) {
-        one_side = t.verticies[2];
-        other_side1 = t.verticies[0];
-        other_side2 = t.verticies[1];
+
+    std::vector<int> candidates;
+    if(strategy == SplitterStrategy::AXIS_ALIGNED) {
+        for(int i = 0; i < (int)triangles.size(); i++)
+            if(is_axis_aligned(build, triangles[i]))
+                candidates.push_back(i);
     }
-    else if((sign_p2 > 0 && sign_p3 > 0) || (sign_p2 < 0 && sign_p3 < 0)) {
-        one_side = t.verticies[0];
-        other_side1 = t.verticies[1];
-        other_side2 = t.verticies[2];
+    if(candidates.empty()) {
+        for(int i = 0; i < (int)triangles.size(); i++)
+            candidates.push_back(i);
     }
-    else {
-        one_side = t.verticies[1];
-        other_side1 = t.verticies[0];
-        other_side2 = t.verticies[2];
+
+    // evenly spaced samples keep builds deterministic
+    VertexArrays corners = build.gather_corners(triangles);
+    int n = candidates.size();
+    int samples = std::min(n, std::max(sample_count, 1));
+    int best = candidates[0];
+    int best_score = INT_MAX;
+    for(int k = 0; k < samples; k++) {
+        int candidate = candidates[(long long)k * n / samples];
+        int score = splitter_score(build, triangles[candidate], triangles, corners);
+        if(score < best_score) {
+            best_score = score;
+            best = candidate;
+        }
     }
 
-    if(line_intersection_with_plane(one_side, other_side1, plane, &intersection1))
+    std::swap(triangles.back(), triangles[best]);
+}
+
+// subtrees with more triangles are built as parallel tasks
+void BSPTree::make_bsp_tree(BuildContext& build, uint32_t node, std::vector<uint32_t>& triangles, int depth) const {
+    if(triangles.size() <= 0 || node == BSP_NO_NODE)
         return;
-    if(line_intersection_with_plane(one_side, other_side2, plane, &intersection2))
+
+    // behind triangles stay in triangles
+    std::vector<uint32_t> front_triangles;
+    partition(build, build.nodes[node].plane, triangles, front_triangles);
+
+    if(triangles.size() > 0) {
+        choose_splitter(build, triangles);
+        build.nodes[node].behind = build.add_node(triangles.back(), depth + 1);
+        triangles.pop_back();
+    }
+    if(front_triangles.size() > 0) {
+        choose_splitter(build, front_triangles);
+        build.nodes[node].front = build.add_node(front_triangles.back(), depth + 1);
+        front_triangles.pop_back();
+    }
+
+    // subtrees share nothing but the arenas, so they can be built at the same time
+    uint32_t behind = build.nodes[node].behind;
+    uint32_t front = build.nodes[node].front;
+    if(front_triangles.size() >= PARALLEL_BUILD_CUTOFF && triangles.size() >= PARALLEL_BUILD_CUTOFF) {
+        TaskGroup group;
+        build.pool.spawn(group, [&]() { make_bsp_tree(build, front, front_triangles, depth + 1); });
+        make_bsp_tree(build, behind, triangles, depth + 1);
+        build.pool.wait(group);
         return;
-    
-    Triangle* t1new = new Triangle(one_side, intersection1, intersection2, t.color);
-    Triangle* t2new = new Triangle(other_side1, intersection1, intersection2, t.color);
-    Triangle* t3new = new Triangle(intersection2, other_side1, other_side2, t.color);
+    }
 
-    triangles.push_back(t1new);
-    triangles.push_back(t2new);
-    triangles.push_back(t3new);
+    make_bsp_tree(build, behind, triangles, depth + 1);
+    make_bsp_tree(build, front, front_triangles, depth + 1);
 }
 
-std::vector<Triangle*> BSPTree::find_front(Triangle* triangle, std::vector<Triangle*>& triangles) const {
-    std::vector<Triangle*> front_triangles;
-    for(const auto& t : triangles) {
-        auto test_result = triangle->plane_cross_triangle(t);
-        if(test_result == 1)
-            front_triangles.push_back(t);
+// nodes in depth first order, mesh triangle i belongs to node i
+// verticies in order of first use
+void BSPTree::flatten(BuildContext& build, uint32_t root) {
+    nodes.clear();
+    mesh.verticies.clear();
+    mesh.triangles.clear();
+    if(root == BSP_NO_NODE)
+        return;
+
+    std::vector<uint32_t> vertex_index(build.verticies.size(), UINT32_MAX);
+    // arena node id, parent index and which child of parent it is
+    struct FlattenEntry {
+        uint32_t node;
+        uint32_t parent;
+        bool is_front;
+    };
+    std::vector<FlattenEntry> stack;
+    stack.push_back({root, BSP_NO_NODE, false});
+    while(!stack.empty()) {
+        FlattenEntry entry = stack.back();
+        stack.pop_back();
+        uint32_t index = nodes.size();
+        const BuildNode& build_node = build.nodes[entry.node];
+        uint32_t t = build_node.triangle;
+        IndexedTriangle triangle = (IndexedTriangle){{0, 0, 0}, build.colors[t], (build.flags[t] & TRIANGLE_VISIBLE) != 0};
+        for(int i = 0; i < 3; i++) {
+            uint32_t v = build.triangles[t].v[i];
+            if(vertex_index[v] == UINT32_MAX)
+                vertex_index[v] = mesh.add_vertex(build.vertex(v));
+            triangle.v[i] = vertex_index[v];
+        }
+        mesh.triangles.push_back(triangle);
+        nodes.push_back(BSPNode(build_node.plane));
+        if(entry.parent != BSP_NO_NODE)
+            (entry.is_front ? nodes[entry.parent].front : nodes[entry.parent].behind) = index;
+
+        // behind subtree comes right after its parent
+        if(build_node.front != BSP_NO_NODE)
+            stack.push_back({build_node.front, index, true});
+        if(build_node.behind != BSP_NO_NODE)
+            stack.push_back({build_node.behind, index, false});
     }
+}
 
-    return front_triangles;
+// children come after parents, so walk nodes backwards
+void BSPTree::compute_bounds() {
+    for(int i = (int)nodes.size() - 1; i >= 0; i--) {
+        BSPNode& node = nodes[i];
+        Vector3 v0 = mesh.vertex(i, 0), v1 = mesh.vertex(i, 1), v2 = mesh.vertex(i, 2);
+        node.bounds_min = Vector3Min(Vector3Min(v0, v1), v2);
+        node.bounds_max = Vector3Max(Vector3Max(v0, v1), v2);
+        for(uint32_t child : {node.behind, node.front}) {
+            if(child == BSP_NO_NODE)
+                continue;
+            node.bounds_min = Vector3Min(node.bounds_min, nodes[child].bounds_min);
+            node.bounds_max = Vector3Max(node.bounds_max, nodes[child].bounds_max);
+        }
+    }
 }
 
-std::vector<Triangle*> BSPTree::find_behind(Triangle* triangle, std::vector<Triangle*>& triangles) const {
-    std::vector<Triangle*> behind_triangles;
-    for(const auto& t : triangles) {
-        auto test_result = triangle->plane_cross_triangle(t);
-        if(test_result == -1)
-            behind_triangles.push_back(t);
+void BSPTree::build(const Mesh& scene_mesh, int build_threads) {
+    this->frustum_culling = true;
+    this->back_face_culling = false;
+    this->draw_order = DrawOrder::BACK_TO_FRONT;
+    this->pvs_culling = true;
+    this->stats = (BSPStats){0, 0, 0, 0, 0.0, 0, 0.0};
+
+    auto start = std::chrono::steady_clock::now();
+
+    // scene is copied into the arenas, split pieces and new verticies are added to them
+    BuildContext build(build_threads, plane_thickness > 0.0f);
+    uint32_t vertex_count = scene_mesh.verticies.size();
+    uint32_t triangle_count = scene_mesh.triangles.size();
+    build.verticies.claim(vertex_count);
+    build.claim_triangles(triangle_count);
+    for(uint32_t i = 0; i < vertex_count; i++)
+        build.verticies[i] = scene_mesh.verticies[i];
+    for(uint32_t i = 0; i < triangle_count; i++) {
+        const IndexedTriangle& t = scene_mesh.triangles[i];
+        build.triangles[i] = (BuildTriangle){{t.v[0], t.v[1], t.v[2]}};
+        build.planes[i] = build.plane_of(scene_mesh.to_plane(i));
+        build.colors[i] = t.color;
+        build.flags[i] = t.visible ? TRIANGLE_VISIBLE : 0;
+    }
+
+    std::vector<uint32_t> tree_triangles(triangle_count);
+    for(size_t i = 0; i < tree_triangles.size(); i++)
+        tree_triangles[i] = i;
+
+    uint32_t root = BSP_NO_NODE;
+    if(tree_triangles.size() > 0) {
+        choose_splitter(build, tree_triangles);
+        root = build.add_node(tree_triangles.back(), 1);
+        tree_triangles.pop_back();
+        make_bsp_tree(build, root, tree_triangles, 1);
+    }
+    flatten(build, root);
+    compute_bounds();
+    for(const auto& thread : build.threads) {
+        stats.node_count += thread.node_count;
+        stats.split_count += thread.split_count;
+        stats.depth = std::max(stats.depth, thread.depth);
+    }
+    stats.vertex_count = mesh.verticies.size();
+
+    mapped_file.reset();
+    pvs_offsets.clear();
+    pvs_data.clear();
+    view = (BSPTreeView){nodes.data(), mesh.triangles.data(), mesh.verticies.data(), (uint32_t)nodes.size(), (uint32_t)mesh.verticies.size(), NULL, NULL};
+    prepare_draw();
+    stats.build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// sizes per frame buffers for current view
+void BSPTree::prepare_draw() {
+    frame = 0;
+    draw_list.reserve(view.node_count);
+    draw_slots.reserve((size_t)view.node_count * 3);
+    vertex_frame.assign(view.vertex_count, 0);
+    vertex_slot.assign(view.vertex_count, 0);
+    vertex_buffer.resize(view.vertex_count);
+    batch.reserve(view.node_count);
+    draw_stats = (BSPDrawStats){0, 0, 0, 0};
+    dynamic_frame = 0;
+    dynamic_node_frame.assign(view.node_count, 0);
+    dynamic_slot_frame.assign(std::max<size_t>((size_t)view.node_count * 2, 2), 0);
+    dynamic_slot_bucket.resize(dynamic_slot_frame.size());
+    pvs_slot = BSP_NO_NODE;
+    pvs_row.assign(((size_t)view.node_count * 2 + 7) / 8, 0);
+    pvs_nodes.assign(view.node_count, 1);
+}
+
+BSPTree::BSPTree() {
+    this->strategy = SplitterStrategy::SAMPLED;
+    this->sample_count = 8;
+    this->plane_thickness = BSP_PLANE_THICKNESS;
+    build(Mesh(), 1);
+}
+
+BSPTree::BSPTree(const Mesh& mesh, SplitterStrategy strategy, int sample_count, int build_threads, float plane_thickness) {
+    this->strategy = strategy;
+    this->sample_count = sample_count;
+    this->plane_thickness = plane_thickness;
+    build(mesh, build_threads);
+}
+
+BSPTree::BSPTree(const std::vector<Triangle*>& triangles, SplitterStrategy strategy, int sample_count, int build_threads, float plane_thickness) {
+    this->strategy = strategy;
+    this->sample_count = sample_count;
+    this->plane_thickness = plane_thickness;
+
+    Mesh triangles_mesh;
+    for(const auto& t : triangles)
+        triangles_mesh.add_triangle(*t);
+    build(triangles_mesh, build_threads);
+}
+
+// split dynamic triangle by plane, returns piece count
+// pieces keep vertex order, verticies on plane go to both sides
+int BSPTree::split_dynamic(uint32_t triangle, const Vector4& plane, float thickness, uint32_t* out_pieces, bool* out_front) const {
+    IndexedTriangle t = dynamic_mesh.triangles[triangle];
+    float signs[3];
+    for(int i = 0; i < 3; i++) {
+        signs[i] = point_in_plane_equasion(dynamic_mesh.verticies[t.v[i]], plane);
+        if(fabsf(signs[i]) <= thickness)
+            signs[i] = 0.0f;
+    }
+
+    // clip triangle to both sides, each side is a polygon of at most 4 verticies
+    uint32_t front[4], behind[4];
+    int front_count = 0, behind_count = 0;
+    for(int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        if(signs[i] >= 0)
+            front[front_count++] = t.v[i];
+        if(signs[i] <= 0)
+            behind[behind_count++] = t.v[i];
+        if((signs[i] > 0 && signs[j] < 0) || (signs[i] < 0 && signs[j] > 0)) {
+            // same point whichever way the edge is walked
+            uint32_t v1 = std::min(t.v[i], t.v[j]);
+            uint32_t v2 = std::max(t.v[i], t.v[j]);
+            Vector3 point;
+            if(line_intersection_with_plane(dynamic_mesh.verticies[v1], dynamic_mesh.verticies[v2], plane, &point) < 0)
+                point = dynamic_mesh.verticies[v1];
+            uint32_t intersection = dynamic_mesh.add_vertex(point);
+            front[front_count++] = intersection;
+            behind[behind_count++] = intersection;
+        }
     }
 
-    return behind_triangles;
+    int count = 0;
+    for(int i = 2; i < front_count; i++) {
+        out_pieces[count] = dynamic_mesh.add_triangle(front[0], front[i - 1], front[i], t.color);
+        out_front[count++] = true;
+    }
+    for(int i = 2; i < behind_count; i++) {
+        out_pieces[count] = dynamic_mesh.add_triangle(behind[0], behind[i - 1], behind[i], t.color);
+        out_front[count++] = false;
+    }
+    return count;
 }
 
-void BSPTree::make_bsp_tree(BSPNode* node, std::vector<Triangle*>& triangles) {
-    if(triangles.size() <= 0 || node == NULL)
+// push dynamic triangles down the tree into empty child slots and depth sort each slot
+// cost is dynamic triangles times depth, static tree is not touched
+void BSPTree::route_dynamic(const Vcam& camera) const {
+    dynamic_buckets.clear();
+    dynamic_entries.clear();
+    dynamic_mesh.verticies.clear();
+    dynamic_mesh.triangles.clear();
+    for(const Mesh& m : dynamic_meshes)
+        dynamic_mesh.append(m);
+    if(dynamic_mesh.triangles.empty())
         return;
-    
-    // split triangles that cross node triangle
-    int i = 0;
-    auto current_node_triangle = node->triangle;
-    while(i < triangles.size()) {
-        auto test_result = current_node_triangle->plane_cross_triangle(triangles[i]);
-        if(test_result == 0) {
-            split(triangles[i], current_node_triangle->to_plane(), triangles);
+
+    dynamic_frame++;
+    if(dynamic_frame == 0) {
+        std::fill(dynamic_node_frame.begin(), dynamic_node_frame.end(), 0);
+        std::fill(dynamic_slot_frame.begin(), dynamic_slot_frame.end(), 0);
+        dynamic_frame = 1;
+    }
+
+    Vector3 camera_pos = camera.get_pos();
+    auto add_entry = [&](uint32_t slot, uint32_t triangle) {
+        Vector3 center = Vector3Scale(Vector3Add(Vector3Add(dynamic_mesh.vertex(triangle, 0), dynamic_mesh.vertex(triangle, 1)), dynamic_mesh.vertex(triangle, 2)), 1.0f / 3.0f);
+        Vector3 offset = Vector3Subtract(center, camera_pos);
+        bool facing_camera = point_in_plane_equasion(camera_pos, dynamic_mesh.to_plane(triangle)) > 0;
+        dynamic_entries.push_back((DynamicEntry){slot, facing_camera, Vector3DotProduct(offset, offset), triangle});
+    };
+
+    dynamic_stack.clear();
+    size_t input_count = dynamic_mesh.triangles.size();
+    for(size_t i = 0; i < input_count; i++) {
+        if(!dynamic_mesh.triangles[i].visible)
+            continue;
+        if(back_face_culling && point_in_plane_equasion(camera_pos, dynamic_mesh.to_plane(i)) <= 0)
+            continue;
+        if(view.node_count == 0)
+            add_entry(0, i);
+        else
+            dynamic_stack.push_back(std::make_pair(0u, (uint32_t)i));
+    }
+
+    while(!dynamic_stack.empty()) {
+        uint32_t node_index = dynamic_stack.back().first;
+        uint32_t triangle = dynamic_stack.back().second;
+        dynamic_stack.pop_back();
+        dynamic_node_frame[node_index] = dynamic_frame;
+
+        const BSPNode& node = view.nodes[node_index];
+        uint32_t pieces[4];
+        bool pieces_front[4];
+        int piece_count = 1;
+        // same thickness rule as build, planes of loaded trees are not always normalized
+        float thickness = plane_thickness * sqrtf(node.plane.x * node.plane.x + node.plane.y * node.plane.y + node.plane.z * node.plane.z);
+        int side = dynamic_mesh.plane_side(triangle, node.plane, thickness);
+        pieces[0] = triangle;
+        pieces_front[0] = side > 0;
+        if(side == 0) {
+            piece_count = split_dynamic(triangle, node.plane, thickness, pieces, pieces_front);
+            draw_stats.dynamic_splits++;
+        }
+
+        for(int i = 0; i < piece_count; i++) {
+            uint32_t child = pieces_front[i] ? node.front : node.behind;
+            if(child == BSP_NO_NODE)
+                add_entry(2 * node_index + pieces_front[i], pieces[i]);
+            else
+                dynamic_stack.push_back(std::make_pair(child, pieces[i]));
+        }
+    }
+
+    // pieces of one slot do not cross any static plane, only order among themselves is left
+    // faces turned away go first, which is exact for one closed convex mesh, then far first
+    std::sort(dynamic_entries.begin(), dynamic_entries.end(), [](const DynamicEntry& a, const DynamicEntry& b) {
+        if(a.slot != b.slot)
+            return a.slot < b.slot;
+        if(a.facing_camera != b.facing_camera)
+            return b.facing_camera;
+        return a.distance > b.distance;
+    });
+    for(uint32_t i = 0; i < dynamic_entries.size(); i++) {
+        uint32_t slot = dynamic_entries[i].slot;
+        if(i > 0 && slot == dynamic_entries[i - 1].slot) {
+            dynamic_buckets.back().end++;
             continue;
         }
-        i++;
+        dynamic_slot_frame[slot] = dynamic_frame;
+        dynamic_slot_bucket[slot] = dynamic_buckets.size();
+        dynamic_buckets.push_back((DynamicBucket){i, i + 1});
     }
 
-    auto behind_triangles = find_behind(current_node_triangle, triangles);
-    auto front_triangles = find_front(current_node_triangle, triangles);
+    size_t vertex_count = dynamic_mesh.verticies.size();
+    dynamic_vertex_frame.resize(vertex_count, 0);
+    dynamic_vertex_slot.resize(vertex_count);
+    if(vertex_buffer.x.size() < view.vertex_count + vertex_count)
+        vertex_buffer.resize(view.vertex_count + vertex_count);
+}
+
+// static bounds do not cover dynamic triangles routed through node
+bool BSPTree::has_dynamic(uint32_t node) const {
+    return !dynamic_buckets.empty() && dynamic_node_frame[node] == dynamic_frame;
+}
 
-    if(behind_triangles.size() > 0) {
-        node->behind = new BSPNode(behind_triangles[0]);
-        behind_triangles.erase(behind_triangles.begin());
+// pushes child, or dynamic bucket waiting in its empty slot
+void BSPTree::push_child(uint32_t node, bool front) const {
+    uint32_t child = front ? view.nodes[node].front : view.nodes[node].behind;
+    uint32_t slot = 2 * node + front;
+    if(child != BSP_NO_NODE) {
+        if(!pvs_active() || pvs_nodes[child])
+            draw_stack.push_back(child);
     }
-    if(front_triangles.size() > 0) {
-        node->front = new BSPNode(front_triangles[0]);
-        front_triangles.erase(front_triangles.begin());
+    else if(!dynamic_buckets.empty() && dynamic_slot_frame[slot] == dynamic_frame && (!pvs_active() || slot_in_pvs(slot)))
+        draw_stack.push_back(dynamic_slot_bucket[slot] | DRAW_BUCKET_BIT);
+}
+
+// empty child slot holding point, same side rule as camera_in_front
+uint32_t BSPTree::find_slot(Vector3 point) const {
+    uint32_t node = 0;
+    while(true) {
+        bool front = point_in_plane_equasion(point, view.nodes[node].plane) > 0;
+        uint32_t child = front ? view.nodes[node].front : view.nodes[node].behind;
+        if(child == BSP_NO_NODE)
+            return 2 * node + front;
+        node = child;
+    }
+}
+
+bool BSPTree::pvs_active() const {
+    return pvs_culling && view.pvs_offsets != NULL;
+}
+
+bool BSPTree::slot_in_pvs(uint32_t slot) const {
+    return (pvs_row[slot >> 3] >> (slot & 7)) & 1;
+}
+
+// appends dynamic triangles of bucket to draw list
+void BSPTree::add_dynamic_bucket(uint32_t bucket, bool far_first) const {
+    const DynamicBucket& range = dynamic_buckets[bucket];
+    for(uint32_t i = range.begin; i < range.end; i++) {
+        uint32_t entry = far_first ? i : range.end - 1 - (i - range.begin);
+        draw_list.push_back(dynamic_entries[entry].triangle | DYNAMIC_DRAW_BIT);
     }
+}
 
-    make_bsp_tree(node->behind, behind_triangles);
-    make_bsp_tree(node->front, front_triangles);
+// draw list entry to triangle, dynamic entries have DYNAMIC_DRAW_BIT set
+const IndexedTriangle& BSPTree::draw_triangle(uint32_t entry) const {
+    if(entry & DYNAMIC_DRAW_BIT)
+        return dynamic_mesh.triangles[entry & ~DYNAMIC_DRAW_BIT];
+    return view.triangles[entry];
 }
 
-void BSPTree::draw(const Vcam& camera, BSPNode* node) const {
-    if(node == NULL)
+// back to front walk with explicit stack, marked entries go to draw list
+void BSPTree::collect_draw_list(const Vcam& camera) const {
+    draw_list.clear();
+    if(view.node_count == 0) {
+        // empty tree, all dynamic triangles wait in bucket 0
+        if(!dynamic_buckets.empty())
+            add_dynamic_bucket(0, true);
         return;
+    }
+
+    Frustum frustum = camera.get_frustum();
+    draw_stack.clear();
+    draw_stack.push_back(0);
+    while(!draw_stack.empty()) {
+        uint32_t entry = draw_stack.back();
+        draw_stack.pop_back();
+        if(entry & DRAW_NODE_BIT) {
+            if(view.triangles[entry & ~DRAW_NODE_BIT].visible)
+                draw_list.push_back(entry & ~DRAW_NODE_BIT);
+            continue;
+        }
+        if(entry & DRAW_BUCKET_BIT) {
+            add_dynamic_bucket(entry & ~DRAW_BUCKET_BIT, true);
+            continue;
+        }
 
-    auto is_camera_front = node->camera_in_front(camera);
-    if(is_camera_front) {
-        draw(camera, node->behind);
-        node->triangle->draw(camera);
-        draw(camera, node->front);
+        const BSPNode& node = view.nodes[entry];
+        COUNTER_ADD(NODES_VISITED, 1);
+        if(frustum_culling && !has_dynamic(entry) && frustum.box_outside(node.bounds_min, node.bounds_max))
+            continue;
+
+        // pushed in reverse, side away from camera is drawn first
+        bool is_camera_front = node.camera_in_front(camera);
+        push_child(entry, is_camera_front);
+        if(is_camera_front || !back_face_culling)
+            draw_stack.push_back(entry | DRAW_NODE_BIT);
+        push_child(entry, !is_camera_front);
+    }
+}
+
+// transform each vertex of draw list once and fill batch
+void BSPTree::fill_batch(const Vcam& camera) const {
+    // new frame makes every cached slot stale
+    frame++;
+    if(frame == 0) {
+        std::fill(vertex_frame.begin(), vertex_frame.end(), 0);
+        std::fill(dynamic_vertex_frame.begin(), dynamic_vertex_frame.end(), 0);
+        frame = 1;
+    }
+
+    size_t count = draw_list.size();
+    draw_slots.resize(count * 3);
+    uint32_t unique = 0;
+    draw_stats.drawn += count;
+    for(size_t i = 0; i < count; i++) {
+        bool is_dynamic = draw_list[i] & DYNAMIC_DRAW_BIT;
+        draw_stats.culled -= !is_dynamic;
+        const IndexedTriangle& t = draw_triangle(draw_list[i]);
+        const Vector3* verticies = is_dynamic ? dynamic_mesh.verticies.data() : view.verticies;
+        uint32_t* frames = is_dynamic ? dynamic_vertex_frame.data() : vertex_frame.data();
+        uint32_t* slots = is_dynamic ? dynamic_vertex_slot.data() : vertex_slot.data();
+        for(int j = 0; j < 3; j++) {
+            uint32_t v = t.v[j];
+            if(frames[v] != frame) {
+                frames[v] = frame;
+                slots[v] = unique;
+                vertex_buffer.x[unique] = verticies[v].x;
+                vertex_buffer.y[unique] = verticies[v].y;
+                vertex_buffer.z[unique] = verticies[v].z;
+                unique++;
+            }
+            draw_slots[3*i + j] = slots[v];
+        }
+    }
+
+    VertexArrays in = vertex_buffer.input();
+    in.count = unique;
+    COUNTER_ADD(VERTICIES_TRANSFORMED, unique);
+    transform_verticies(camera.get_view_project_mat(), in, vertex_buffer.output());
+
+    batch.clear();
+    for(size_t i = 0; i < count; i++) {
+        const Color& color = draw_triangle(draw_list[i]).color;
+        const uint32_t* slots = &draw_slots[3*i];
+        // only triangles crossing near or far plane need clipping
+        if(vertex_buffer.in_depth_range(slots[0]) && vertex_buffer.in_depth_range(slots[1]) && vertex_buffer.in_depth_range(slots[2])) {
+            batch.add(vertex_buffer.screen(slots[0]), vertex_buffer.screen(slots[1]), vertex_buffer.screen(slots[2]), color);
+        }
+        else {
+            Vector4 clip_verticies[3] = {vertex_buffer.clip(slots[0]), vertex_buffer.clip(slots[1]), vertex_buffer.clip(slots[2])};
+            int added = draw_clipped_triangle(clip_verticies, color, batch);
+            draw_stats.clipped++;
+            COUNTER_ADD(TRIANGLES_CLIPPED, added > 0);
+            COUNTER_ADD(TRIANGLES_REJECTED, added == 0);
+        }
     }
-    else {
-        draw(camera, node->front);
-        node->triangle->draw(camera);
-        draw(camera, node->behind);
+    COUNTER_ADD(TRIANGLES_SUBMITTED, batch.size());
+}
+
+// screen rectangle of node bounds, false if bounds reach past near plane
+bool BSPTree::screen_bounds(const BSPNode& node, const Matrix& view_project, int* min_x, int* min_y, int* max_x, int* max_y) const {
+    Vector2 screen_min = (Vector2){INFINITY, INFINITY};
+    Vector2 screen_max = (Vector2){-INFINITY, -INFINITY};
+    for(int i = 0; i < 8; i++) {
+        Vector3 corner = (Vector3){
+            i & 1 ? node.bounds_max.x : node.bounds_min.x,
+            i & 2 ? node.bounds_max.y : node.bounds_min.y,
+            i & 4 ? node.bounds_max.z : node.bounds_min.z
+        };
+        Vector4 clip = multiply_mv4(view_project, corner);
+        if(clip.z < -clip.w || clip.w <= 0)
+            return false;
+        Vector2 screen = get_2d_screen_vec((Vector3){clip.x/clip.w, clip.y/clip.w, clip.z/clip.w});
+        screen_min = (Vector2){fminf(screen_min.x, screen.x), fminf(screen_min.y, screen.y)};
+        screen_max = (Vector2){fmaxf(screen_max.x, screen.x), fmaxf(screen_max.y, screen.y)};
     }
+
+    // one pixel margin against rounding
+    *min_x = (int)floorf(std::max(screen_min.x, -1e6f)) - 1;
+    *min_y = (int)floorf(std::max(screen_min.y, -1e6f)) - 1;
+    *max_x = (int)ceilf(std::min(screen_max.x, 1e6f)) + 1;
+    *max_y = (int)ceilf(std::min(screen_max.y, 1e6f)) + 1;
+    return true;
 }
 
-void BSPTree::restore_triangles(std::vector<Triangle*>& triangles) {
-    triangles.clear();
-    restore_triangles(root, triangles);
+// front to back walk, drawn in chunks so covered subtrees can be skipped
+void BSPTree::draw_front_to_back(const Vcam& camera, RenderTarget& target) const {
+    draw_list.clear();
+    if(view.node_count == 0) {
+        collect_draw_list(camera);
+        COUNTER_SCOPE(SUBMISSION);
+        fill_batch(camera);
+        target.draw(batch);
+        return;
+    }
+
+    // coverage seen by subtree tests is updated after every chunk
+    // chunks grow so big scenes still get big batches
+    size_t chunk_size = FRONT_TO_BACK_FIRST_CHUNK;
+    auto flush = [&]() {
+        COUNTER_SCOPE(SUBMISSION);
+        fill_batch(camera);
+        target.draw(batch);
+        draw_list.clear();
+        chunk_size *= 2;
+    };
+
+    target.set_front_to_back(true);
+    Frustum frustum = camera.get_frustum();
+    Matrix view_project = camera.get_view_project_mat();
+    draw_stack.clear();
+    draw_stack.push_back(0);
+    while(!draw_stack.empty()) {
+        uint32_t entry = draw_stack.back();
+        draw_stack.pop_back();
+        if(entry & (DRAW_NODE_BIT | DRAW_BUCKET_BIT)) {
+            if(entry & DRAW_BUCKET_BIT)
+                add_dynamic_bucket(entry & ~DRAW_BUCKET_BIT, false);
+            else if(view.triangles[entry & ~DRAW_NODE_BIT].visible)
+                draw_list.push_back(entry & ~DRAW_NODE_BIT);
+            if(draw_list.size() >= chunk_size)
+                flush();
+            continue;
+        }
+
+        // static bounds say nothing about dynamic triangles below node
+        const BSPNode& node = view.nodes[entry];
+        COUNTER_ADD(NODES_VISITED, 1);
+        bool is_dynamic = has_dynamic(entry);
+        if(frustum_culling && !is_dynamic && frustum.box_outside(node.bounds_min, node.bounds_max))
+            continue;
+        int min_x, min_y, max_x, max_y;
+        if(!is_dynamic && screen_bounds(node, view_project, &min_x, &min_y, &max_x, &max_y) && target.is_covered(min_x, min_y, max_x, max_y))
+            continue;
+
+        // pushed in reverse, side of camera is drawn first
+        bool is_camera_front = node.camera_in_front(camera);
+        push_child(entry, !is_camera_front);
+        if(is_camera_front || !back_face_culling)
+            draw_stack.push_back(entry | DRAW_NODE_BIT);
+        push_child(entry, is_camera_front);
+    }
+    if(!draw_list.empty())
+        flush();
+    target.set_front_to_back(false);
 }
 
-void BSPTree::restore_triangles(BSPNode* node, std::vector<Triangle*>& triangles) {
-    if(node == NULL)
+void BSPTree::draw(Vcam camera, RenderTarget& target) const {
+    COUNTER_SCOPE(TRAVERSAL);
+    draw_stats = (BSPDrawStats){0, (int)view.node_count, 0, 0};
+    update_pvs(camera);
+    route_dynamic(camera);
+    if(draw_order == DrawOrder::FRONT_TO_BACK && target.supports_front_to_back()) {
+        draw_front_to_back(camera, target);
         return;
+    }
 
-    triangles.push_back(node->triangle);
-    restore_triangles(node->behind, triangles);
-    restore_triangles(node->front, triangles);
+    collect_draw_list(camera);
+    COUNTER_SCOPE(SUBMISSION);
+    fill_batch(camera);
+    target.draw(batch);
 }
 
-BSPTree::BSPTree(std::vector<Triangle*>& triangles) {
-    if(triangles.size() > 0) {
-        root = new BSPNode(triangles[0]);
-        triangles.erase(triangles.begin());
+// PVS rays start this far off a triangle, relative to scene size
+const float PVS_SAMPLE_OFFSET = 1e-4f;
+// plane distance treated as on the plane by PVS rays
+const float PVS_PLANE_EPSILON = 1e-4f;
+// sample points per leaf, first ones come from the triangle next to the leaf
+const size_t PVS_MAX_ORIGINS = 16;
+// random walk steps tried per leaf to spread sample points
+const int PVS_WALK_ATTEMPTS = 32;
+// halvings when finding how far a leaf reaches along a line
+const int PVS_WALK_STEPS = 16;
+// random points thrown into scene bounds per leaf, find leaves no triangle sample landed in
+const int PVS_RANDOM_SAMPLES = 2;
+// rays cast from one sample point before moving to the next
+const int PVS_ROUND_RAYS = 64;
+// rounds in a row that reach no new slot before leaf stops casting
+const int PVS_STABLE_ROUNDS = 4;
+// segments tried between sample points of two leaves no ray connected
+const int PVS_PAIR_SEGMENTS = 8;
+
+// zero bytes are stored as a zero and run length, other bytes as they are
+static void compress_pvs_row(const std::vector<uint8_t>& row, std::vector<uint8_t>& out) {
+    for(size_t i = 0; i < row.size(); i++) {
+        if(row[i] != 0) {
+            out.push_back(row[i]);
+            continue;
+        }
+        size_t run = 1;
+        while(i + run < row.size() && row[i + run] == 0 && run < 255)
+            run++;
+        out.push_back(0);
+        out.push_back(run);
+        i += run - 1;
+    }
+}
+
+// bytes past end of data are zero, runs are cut at row end
+static void decompress_pvs_row(const uint8_t* data, const uint8_t* end, uint8_t* row, size_t row_bytes) {
+    size_t i = 0;
+    while(data < end && i < row_bytes) {
+        if(*data != 0) {
+            row[i++] = *data++;
+            continue;
+        }
+        size_t run = data + 1 < end ? data[1] : 0;
+        run = std::min(run, row_bytes - i);
+        memset(row + i, 0, run);
+        i += run;
+        data += 2;
+    }
+    memset(row + i, 0, row_bytes - i);
+}
+
+// ray hits triangle of node, point is on its plane, edges are a bit thick so rays do not leak between neighbours
+static bool pvs_ray_hits_triangle(const BSPTreeView& view, uint32_t node, Vector3 point) {
+    const uint32_t* v = view.triangles[node].v;
+    Vector3 p[3] = {view.verticies[v[0]], view.verticies[v[1]], view.verticies[v[2]]};
+    Vector3 normal = Vector3CrossProduct(Vector3Subtract(p[1], p[0]), Vector3Subtract(p[2], p[0]));
+    float normal_length = Vector3Length(normal);
+    if(normal_length == 0.0f)
+        return false;
+    for(int i = 0; i < 3; i++) {
+        Vector3 edge = Vector3Subtract(p[(i + 1) % 3], p[i]);
+        float edge_distance = Vector3DotProduct(Vector3CrossProduct(edge, Vector3Subtract(point, p[i])), normal) / (normal_length * Vector3Length(edge));
+        if(edge_distance < -PVS_PLANE_EPSILON)
+            return false;
+    }
+    return true;
+}
+
+// slots reached from one leaf, marked has an entry per slot
+// step of a pvs ray walk, steps run in order until one hits a triangle
+struct PVSTraceStep {
+    enum Kind : uint8_t {
+        // walk ray piece from t_min to t_max through subtree of node
+        VISIT,
+        // test triangle of node at t_min, front tells which of its slots a hit marks
+        HIT,
+        // mark slot
+        LEAF
+    };
+    Kind kind;
+    bool front;
+    uint32_t node;
+    float t_min;
+    float t_max;
+};
+
+struct PVSReached {
+    std::vector<uint8_t> marked;
+    std::vector<uint32_t> slots;
+    // reused by trace_pvs_ray, steps still to run, last runs next
+    std::vector<PVSTraceStep> steps;
+
+    void mark(uint32_t slot) {
+        if(!marked[slot]) {
+            marked[slot] = 1;
+            slots.push_back(slot);
+        }
+    }
+};
+
+// walks ray from t_min to t_max through subtree nearest part first, marks every empty slot it passes
+// hit triangle marks a slot of its node, so a hit coplanar piece counts even when no leaf next to it is reached
+// returns true when a node triangle stops it
+// explicit step stack instead of recursion, degenerate trees are as deep as they have triangles
+static bool trace_pvs_ray(const BSPTreeView& view, uint32_t root, Vector3 origin, Vector3 direction, float t_min, float t_max, PVSReached& reached) {
+    std::vector<PVSTraceStep>& steps = reached.steps;
+    steps.clear();
+    PVSTraceStep step = (PVSTraceStep){PVSTraceStep::VISIT, false, root, t_min, t_max};
+    while(true) {
+        uint32_t node = step.node;
+        if(step.kind == PVSTraceStep::LEAF)
+            reached.mark(2 * node + step.front);
+        else if(step.kind == PVSTraceStep::HIT) {
+            if(pvs_ray_hits_triangle(view, node, Vector3Add(origin, Vector3Scale(direction, step.t_min)))) {
+                reached.mark(2 * node + step.front);
+                return true;
+            }
+        }
+        else {
+            const BSPNode& n = view.nodes[node];
+            // steps of this node in walk order
+            PVSTraceStep order[4];
+            int count = 0;
+            auto visit = [&](bool front, float t0, float t1) {
+                uint32_t child = front ? n.front : n.behind;
+                if(child != BSP_NO_NODE)
+                    order[count++] = (PVSTraceStep){PVSTraceStep::VISIT, front, child, t0, t1};
+                else
+                    order[count++] = (PVSTraceStep){PVSTraceStep::LEAF, front, node, t0, t1};
+            };
+            auto hit = [&](float t, bool front) {
+                order[count++] = (PVSTraceStep){PVSTraceStep::HIT, front, node, t, t};
+            };
+
+            // planes are not always normalized, distances are
+            float t0 = step.t_min, t1 = step.t_max;
+            Vector3 normal = (Vector3){n.plane.x, n.plane.y, n.plane.z};
+            float normal_length = Vector3Length(normal);
+            float start = point_in_plane_equasion(Vector3Add(origin, Vector3Scale(direction, t0)), n.plane) / normal_length;
+            float end = point_in_plane_equasion(Vector3Add(origin, Vector3Scale(direction, t1)), n.plane) / normal_length;
+            bool start_on_plane = fabsf(start) <= PVS_PLANE_EPSILON;
+            bool end_on_plane = fabsf(end) <= PVS_PLANE_EPSILON;
+
+            // ray pieces cut at a parent plane start or end on it, coplanar triangles were sent to front subtrees
+            // so a piece touching the plane from behind also probes the front subtree at the touching point
+            if(start_on_plane && end_on_plane) {
+                hit(t0, true);
+                visit(true, t0, t1);
+                visit(false, t0, t1);
+            }
+            else if(start_on_plane) {
+                hit(t0, end > 0);
+                if(end < 0)
+                    visit(true, t0, t0);
+                visit(end > 0, t0, t1);
+            }
+            else if(end_on_plane) {
+                visit(start > 0, t0, t1);
+                hit(t1, start > 0);
+                if(start < 0)
+                    visit(true, t1, t1);
+            }
+            else if((start > 0) == (end > 0))
+                visit(start > 0, t0, t1);
+            else {
+                float t_split = t0 + (t1 - t0) * start / (start - end);
+                visit(start > 0, t0, t_split);
+                hit(t_split, start > 0);
+                visit(end > 0, t_split, t1);
+            }
+
+            // first step runs next without going through the stack, the rest wait reversed
+            for(int i = count - 1; i > 0; i--)
+                steps.push_back(order[i]);
+            step = order[0];
+            continue;
+        }
+
+        if(steps.empty())
+            return false;
+        step = steps.back();
+        steps.pop_back();
+    }
+}
+
+// decodes row of camera leaf and marks nodes with a set slot at or below them, only when leaf changed
+void BSPTree::update_pvs(const Vcam& camera) const {
+    if(!pvs_active() || view.node_count == 0)
+        return;
+    uint32_t slot = find_slot(camera.get_pos());
+    if(slot == pvs_slot)
+        return;
+
+    pvs_slot = slot;
+    // empty row, leaf no sample point landed in sees everything, dynamic buckets in every slot too
+    if(view.pvs_offsets[slot] == view.pvs_offsets[slot + 1]) {
+        std::fill(pvs_row.begin(), pvs_row.end(), 0xFF);
+        std::fill(pvs_nodes.begin(), pvs_nodes.end(), 1);
+        return;
+    }
+    decompress_pvs_row(view.pvs_data + view.pvs_offsets[slot], view.pvs_data + view.pvs_offsets[slot + 1], pvs_row.data(), pvs_row.size());
+    // children come after parents, so walk nodes backwards
+    for(int i = (int)view.node_count - 1; i >= 0; i--) {
+        const BSPNode& node = view.nodes[i];
+        pvs_nodes[i] = slot_in_pvs(2 * i) || slot_in_pvs(2 * i + 1) ||
+            (node.behind != BSP_NO_NODE && pvs_nodes[node.behind]) ||
+            (node.front != BSP_NO_NODE && pvs_nodes[node.front]);
+    }
+}
+
+// offline pass, from every leaf rays go out in spread directions, then segments go to sample points of leaves not reached yet
+// everything a ray or segment passes before hitting a triangle is visible
+// visibility is made mutual, leaf seen from one side only is taken as seen from both
+void BSPTree::build_pvs(int rays_per_leaf, int build_threads) {
+    auto start = std::chrono::steady_clock::now();
+    pvs_offsets.clear();
+    pvs_data.clear();
+    view.pvs_offsets = NULL;
+    view.pvs_data = NULL;
+    stats.pvs_bytes = 0;
+    stats.pvs_build_time = 0.0;
+    pvs_slot = BSP_NO_NODE;
+    if(view.node_count == 0)
+        return;
+
+    // root bounds hold whole scene, rays end past them
+    uint32_t slot_count = 2 * view.node_count;
+    Vector3 bounds_min = view.nodes[0].bounds_min;
+    Vector3 bounds_max = view.nodes[0].bounds_max;
+    Vector3 bounds_size = Vector3Subtract(bounds_max, bounds_min);
+    float scene_size = std::max(Vector3Length(bounds_size), 1e-3f);
+    float offset = scene_size * PVS_SAMPLE_OFFSET;
+    float ray_length = scene_size * 2.0f;
+
+    // points just off centroid and corners of node triangle lie in the empty slot on that side
+    // unless the slot has no volume, as behind slots of coplanar triangles
+    std::vector<std::vector<Vector3>> origins(slot_count);
+    uint32_t leaf_count = 0;
+    for(uint32_t i = 0; i < view.node_count; i++) {
+        const uint32_t* v = view.triangles[i].v;
+        Vector3 p[3] = {view.verticies[v[0]], view.verticies[v[1]], view.verticies[v[2]]};
+        Vector3 centroid = Vector3Scale(Vector3Add(Vector3Add(p[0], p[1]), p[2]), 1.0f / 3.0f);
+        Vector3 normal = (Vector3){view.nodes[i].plane.x, view.nodes[i].plane.y, view.nodes[i].plane.z};
+        if(Vector3Length(normal) == 0.0f)
+            continue;
+        normal = Vector3Normalize(normal);
+        Vector3 points[4] = {centroid, Vector3Lerp(centroid, p[0], 0.8f), Vector3Lerp(centroid, p[1], 0.8f), Vector3Lerp(centroid, p[2], 0.8f)};
+        for(int front = 0; front < 2; front++) {
+            if((front ? view.nodes[i].front : view.nodes[i].behind) != BSP_NO_NODE)
+                continue;
+            leaf_count++;
+            uint32_t slot = 2 * i + front;
+            for(Vector3 point : points) {
+                point = Vector3Add(point, Vector3Scale(normal, front ? offset : -offset));
+                if(find_slot(point) == slot)
+                    origins[slot].push_back(point);
+            }
+        }
+    }
+
+    // random points seed leaves with no triangle sample, fixed seed keeps builds the same
+    uint32_t random_state = 2463534242u;
+    auto random_unit = [&]() {
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+        return (random_state >> 8) * (1.0f / 16777216.0f);
+    };
+    for(uint32_t i = 0; i < leaf_count * PVS_RANDOM_SAMPLES; i++) {
+        Vector3 point = (Vector3){
+            bounds_min.x + bounds_size.x * random_unit(),
+            bounds_min.y + bounds_size.y * random_unit(),
+            bounds_min.z + bounds_size.z * random_unit()
+        };
+        uint32_t slot = find_slot(point);
+        if(origins[slot].size() < PVS_MAX_ORIGINS)
+            origins[slot].push_back(point);
+    }
+
+    std::vector<uint32_t> sampled;
+    for(uint32_t slot = 0; slot < slot_count; slot++)
+        if(!origins[slot].empty())
+            sampled.push_back(slot);
+
+    // every sampled leaf on its own task
+    ThreadPool pool(build_threads);
+    pool.parallel_for(sampled.size(), [&](size_t index) {
+        uint32_t slot = sampled[index];
+        std::vector<Vector3>& from = origins[slot];
+
+        // leaves are convex, so points of a line inside one form an interval
+        // random walk along random lines spreads sample points over the whole leaf
+        uint32_t walk_state = slot * 2654435761u + 1;
+        auto walk_unit = [&]() {
+            walk_state ^= walk_state << 13;
+            walk_state ^= walk_state >> 17;
+            walk_state ^= walk_state << 5;
+            return (walk_state >> 8) * (1.0f / 16777216.0f);
+        };
+        auto leaf_extent = [&](Vector3 point, Vector3 direction) {
+            float inside = 0.0f, outside = scene_size;
+            for(int i = 0; i < PVS_WALK_STEPS; i++) {
+                float t = (inside + outside) * 0.5f;
+                if(find_slot(Vector3Add(point, Vector3Scale(direction, t))) == slot)
+                    inside = t;
+                else
+                    outside = t;
+            }
+            return inside;
+        };
+        Vector3 point = from[0];
+        for(int i = 0; i < PVS_WALK_ATTEMPTS && from.size() < PVS_MAX_ORIGINS; i++) {
+            float y = 2.0f * walk_unit() - 1.0f;
+            float radius = sqrtf(std::max(1.0f - y * y, 0.0f));
+            float angle = 2.0f * PI * walk_unit();
+            Vector3 direction = (Vector3){radius * cosf(angle), y, radius * sinf(angle)};
+            float forward = leaf_extent(point, direction);
+            float backward = leaf_extent(point, Vector3Negate(direction));
+            if(forward + backward <= offset)
+                continue;
+            point = Vector3Add(point, Vector3Scale(direction, walk_unit() * (forward + backward) - backward));
+            if(find_slot(point) == slot)
+                from.push_back(point);
+        }
+    });
+
+    std::vector<std::vector<uint32_t>> visible(slot_count);
+    std::vector<PVSReached> reached(pool.size());
+    for(auto& r : reached)
+        r.marked.assign(slot_count, 0);
+    pool.parallel_for(sampled.size(), [&](size_t index) {
+        uint32_t slot = sampled[index];
+        const std::vector<Vector3>& from = origins[slot];
+        PVSReached& r = reached[pool.thread_index()];
+        r.slots.clear();
+        r.mark(slot);
+
+        // evenly spread directions, turned per round, sample points taken in turn
+        // stops once a few rounds in a row find nothing new
+        int stable = 0;
+        for(int round = 0; round * PVS_ROUND_RAYS < rays_per_leaf && (round < (int)from.size() || stable < PVS_STABLE_ROUNDS); round++) {
+            size_t before = r.slots.size();
+            float turn = (slot * 7 + round) * 0.61803398f;
+            for(int i = 0; i < PVS_ROUND_RAYS; i++) {
+                float y = 1.0f - 2.0f * (i + 0.5f) / PVS_ROUND_RAYS;
+                float radius = sqrtf(std::max(1.0f - y * y, 0.0f));
+                float angle = 2.0f * PI * (i * 0.38196601f + turn);
+                Vector3 direction = (Vector3){radius * cosf(angle), y, radius * sinf(angle)};
+                trace_pvs_ray(view, 0, from[round % from.size()], direction, 0.0f, ray_length, r);
+            }
+            stable = r.slots.size() == before ? stable + 1 : 0;
+        }
+
+        // leaves after this one no ray reached, leaves before got their turn and are mirrored below
+        for(size_t other = index + 1; other < sampled.size(); other++) {
+            const std::vector<Vector3>& to = origins[sampled[other]];
+            for(int k = 0; k < PVS_PAIR_SEGMENTS && !r.marked[sampled[other]]; k++) {
+                Vector3 a = from[k % from.size()];
+                Vector3 b = to[(k + k / from.size()) % to.size()];
+                trace_pvs_ray(view, 0, a, Vector3Subtract(b, a), 0.0f, 1.0f, r);
+            }
+        }
+
+        for(uint32_t s : r.slots)
+            r.marked[s] = 0;
+        visible[slot] = r.slots;
+    });
+
+    // visibility goes both ways, what one leaf missed may have been found from the other
+    std::vector<std::vector<uint32_t>> seen_by(slot_count);
+    for(uint32_t slot : sampled)
+        for(uint32_t other : visible[slot])
+            if(other != slot && !origins[other].empty())
+                seen_by[other].push_back(slot);
+
+    // leaves without samples keep empty rows
+    std::vector<uint8_t> row;
+    pvs_offsets.reserve(slot_count + 1);
+    for(uint32_t slot = 0; slot < slot_count; slot++) {
+        pvs_offsets.push_back(pvs_data.size());
+        if(origins[slot].empty())
+            continue;
+        row.assign(pvs_row.size(), 0);
+        for(const auto* slots : {&visible[slot], &seen_by[slot]})
+            for(uint32_t s : *slots)
+                row[s >> 3] |= 1 << (s & 7);
+        compress_pvs_row(row, pvs_data);
+    }
+    pvs_offsets.push_back(pvs_data.size());
+
+    view.pvs_offsets = pvs_offsets.data();
+    view.pvs_data = pvs_data.data();
+    stats.pvs_bytes = pvs_offsets.size() * sizeof(uint32_t) + pvs_data.size();
+    stats.pvs_build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool BSPTree::has_pvs() const {
+    return view.pvs_offsets != NULL;
+}
+
+// copy of triangles and verticies after splitting, triangle i belongs to node i
+Mesh BSPTree::get_mesh() const {
+    Mesh tree_mesh;
+    tree_mesh.verticies.assign(view.verticies, view.verticies + view.vertex_count);
+    tree_mesh.triangles.assign(view.triangles, view.triangles + view.node_count);
+    return tree_mesh;
+}
+
+size_t BSPTree::triangle_count() const {
+    return view.node_count;
+}
+
+// tree file header, arrays follow at 16 byte aligned offsets
+// nodes, then triangles, then verticies, then PVS offsets and rows if there is a PVS, all in machine layout
+struct BSPFileHeader {
+    char magic[4];
+    uint32_t version;
+    // BSP_FILE_BYTE_ORDER as stored by saving machine
+    uint32_t byte_order;
+    // stored struct sizes, catch layout changes
+    uint32_t node_size;
+    uint32_t triangle_size;
+    uint32_t vertex_size;
+    uint32_t node_count;
+    uint32_t vertex_count;
+    int32_t depth;
+    int32_t split_count;
+    // bytes of compressed PVS rows, 0 without PVS
+    uint32_t pvs_size;
+    // build plane thickness, dynamic meshes are routed with it
+    float plane_thickness;
+    uint64_t node_offset;
+    uint64_t triangle_offset;
+    uint64_t vertex_offset;
+    // 2 * node_count + 1 offsets into PVS rows
+    uint64_t pvs_offsets_offset;
+    uint64_t pvs_data_offset;
+};
+
+const char BSP_FILE_MAGIC[4] = {'V', 'B', 'S', 'P'};
+// bump when layout of stored structs or header changes
+const uint32_t BSP_FILE_VERSION = 3;
+const uint32_t BSP_FILE_BYTE_ORDER = 0x01020304;
+const uint64_t BSP_FILE_ALIGN = 16;
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + BSP_FILE_ALIGN - 1) / BSP_FILE_ALIGN * BSP_FILE_ALIGN;
+}
+
+static bool write_padded(FILE* file, const void* data, size_t size) {
+    static const char zeros[BSP_FILE_ALIGN] = {};
+    size_t padding = align_offset(size) - size;
+    return fwrite(data, 1, size, file) == size && fwrite(zeros, 1, padding, file) == padding;
+}
+
+// versioned binary file, arrays are laid out as in memory so load can use them in place
+bool BSPTree::save(const char* path) const {
+    BSPFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BSP_FILE_MAGIC, sizeof(header.magic));
+    header.version = BSP_FILE_VERSION;
+    header.byte_order = BSP_FILE_BYTE_ORDER;
+    header.node_size = sizeof(BSPNode);
+    header.triangle_size = sizeof(IndexedTriangle);
+    header.vertex_size = sizeof(Vector3);
+    header.node_count = view.node_count;
+    header.vertex_count = view.vertex_count;
+    header.depth = stats.depth;
+    header.split_count = stats.split_count;
+    header.plane_thickness = plane_thickness;
+    header.node_offset = align_offset(sizeof(header));
+    header.triangle_offset = header.node_offset + align_offset((uint64_t)view.node_count * sizeof(BSPNode));
+    header.vertex_offset = header.triangle_offset + align_offset((uint64_t)view.node_count * sizeof(IndexedTriangle));
+    size_t pvs_offset_count = view.pvs_offsets != NULL ? (size_t)view.node_count * 2 + 1 : 0;
+    header.pvs_size = view.pvs_offsets != NULL ? view.pvs_offsets[pvs_offset_count - 1] : 0;
+    header.pvs_offsets_offset = header.vertex_offset + align_offset((uint64_t)view.vertex_count * sizeof(Vector3));
+    header.pvs_data_offset = header.pvs_offsets_offset + align_offset((uint64_t)pvs_offset_count * sizeof(uint32_t));
+
+    // copies keep struct padding zeroed, so same tree gives same file
+    std::vector<IndexedTriangle> triangles(view.node_count);
+    memset(triangles.data(), 0, triangles.size() * sizeof(IndexedTriangle));
+    for(uint32_t i = 0; i < view.node_count; i++) {
+        memcpy(triangles[i].v, view.triangles[i].v, sizeof(triangles[i].v));
+        triangles[i].color = view.triangles[i].color;
+        triangles[i].visible = view.triangles[i].visible;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+        return false;
+    bool ok = write_padded(file, &header, sizeof(header)) &&
+        write_padded(file, view.nodes, (size_t)view.node_count * sizeof(BSPNode)) &&
+        write_padded(file, triangles.data(), triangles.size() * sizeof(IndexedTriangle)) &&
+        write_padded(file, view.verticies, (size_t)view.vertex_count * sizeof(Vector3));
+    if(view.pvs_offsets != NULL)
+        ok = ok && write_padded(file, view.pvs_offsets, pvs_offset_count * sizeof(uint32_t)) &&
+            write_padded(file, view.pvs_data, header.pvs_size);
+    return fclose(file) == 0 && ok;
+}
+
+// indices read from file stay inside their arrays, children come after parents so walks end
+// pvs offsets of size node_count * 2 + 1 when there is a pvs
+static bool valid_tree_view(const BSPTreeView& view, uint64_t pvs_size) {
+    for(uint32_t i = 0; i < view.node_count; i++) {
+        for(uint32_t child : {view.nodes[i].behind, view.nodes[i].front})
+            if(child != BSP_NO_NODE && (child <= i || child >= view.node_count))
+                return false;
+        for(uint32_t v : view.triangles[i].v)
+            if(v >= view.vertex_count)
+                return false;
     }
-    make_bsp_tree(root, triangles);
-    restore_triangles(triangles);
+    if(view.pvs_offsets == NULL)
+        return true;
+
+    size_t offset_count = (size_t)view.node_count * 2 + 1;
+    for(size_t i = 1; i < offset_count; i++)
+        if(view.pvs_offsets[i] < view.pvs_offsets[i - 1])
+            return false;
+    return view.pvs_offsets[offset_count - 1] <= pvs_size;
+}
+
+// maps file and draws straight from it, false if file is missing or not a valid tree
+bool BSPTree::load(const char* path) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if(!file->open(path) || file->get_size() < sizeof(BSPFileHeader))
+        return false;
+
+    char* data = (char*)file->get_data();
+    uint64_t size = file->get_size();
+    const BSPFileHeader* header = (const BSPFileHeader*)data;
+    if(memcmp(header->magic, BSP_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != BSP_FILE_VERSION ||
+        header->byte_order != BSP_FILE_BYTE_ORDER ||
+        header->node_size != sizeof(BSPNode) ||
+        header->triangle_size != sizeof(IndexedTriangle) ||
+        header->vertex_size != sizeof(Vector3) ||
+        !(header->plane_thickness >= 0.0f && header->plane_thickness < INFINITY))
+        return false;
+
+    bool has_pvs = header->pvs_size > 0;
+    uint64_t offsets[5] = {header->node_offset, header->triangle_offset, header->vertex_offset, header->pvs_offsets_offset, header->pvs_data_offset};
+    uint64_t lengths[5] = {
+        (uint64_t)header->node_count * sizeof(BSPNode),
+        (uint64_t)header->node_count * sizeof(IndexedTriangle),
+        (uint64_t)header->vertex_count * sizeof(Vector3),
+        has_pvs ? ((uint64_t)header->node_count * 2 + 1) * sizeof(uint32_t) : 0,
+        header->pvs_size
+    };
+    for(int i = 0; i < (has_pvs ? 5 : 3); i++)
+        if(offsets[i] % BSP_FILE_ALIGN != 0 || offsets[i] > size || lengths[i] > size - offsets[i])
+            return false;
+
+    BSPTreeView file_view = (BSPTreeView){
+        (const BSPNode*)(data + header->node_offset),
+        (IndexedTriangle*)(data + header->triangle_offset),
+        (const Vector3*)(data + header->vertex_offset),
+        header->node_count,
+        header->vertex_count,
+        has_pvs ? (const uint32_t*)(data + header->pvs_offsets_offset) : NULL,
+        has_pvs ? (const uint8_t*)(data + header->pvs_data_offset) : NULL
+    };
+    if(!valid_tree_view(file_view, header->pvs_size))
+        return false;
+
+    nodes = std::vector<BSPNode>();
+    mesh = Mesh();
+    pvs_offsets = std::vector<uint32_t>();
+    pvs_data = std::vector<uint8_t>();
+    view = file_view;
+    plane_thickness = header->plane_thickness;
+    stats = (BSPStats){header->depth, (int)header->node_count, header->split_count, (int)header->vertex_count, 0.0, (size_t)(lengths[3] + lengths[4]), 0.0};
+    mapped_file = std::move(file);
+    prepare_draw();
+    // load time stands in for build time
+    stats.build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+// moving mesh drawn with the tree, split into its leaves every draw instead of rebuilding
+size_t BSPTree::add_dynamic_mesh(const Mesh& mesh) {
+    dynamic_meshes.push_back(mesh);
+    return dynamic_meshes.size() - 1;
+}
+
+void BSPTree::update_dynamic_mesh(size_t id, const Mesh& mesh) {
+    dynamic_meshes[id] = mesh;
+}
+
+// id stays taken, so other ids do not move
+void BSPTree::remove_dynamic_mesh(size_t id) {
+    dynamic_meshes[id] = Mesh();
+}
+
+void BSPTree::set_triangle_visible(size_t triangle, bool visible) {
+    view.triangles[triangle].visible = visible;
+}
+
+BSPStats BSPTree::get_stats() const {
+    return stats;
+}
+
+BSPDrawStats BSPTree::get_draw_stats() const {
+    return draw_stats;
+}
+
+// bytes of tree arrays and per frame draw buffers, mapped tree file counted whole
+size_t BSPTree::memory_usage() const {
+    size_t bytes = nodes.capacity() * sizeof(BSPNode) + mesh.memory_usage() +
+        pvs_offsets.capacity() * sizeof(uint32_t) + pvs_data.capacity() + pvs_row.capacity() + pvs_nodes.capacity();
+    if(mapped_file)
+        bytes += mapped_file->get_size();
+    bytes += (draw_stack.capacity() + draw_list.capacity() + vertex_frame.capacity() + vertex_slot.capacity() + draw_slots.capacity()) * sizeof(uint32_t);
+    bytes += vertex_buffer.memory_usage();
+    bytes += batch.get_verticies().capacity() * sizeof(Vector2) + batch.get_colors().capacity() * sizeof(Color);
+    bytes += (dynamic_node_frame.capacity() + dynamic_slot_frame.capacity() + dynamic_slot_bucket.capacity()) * sizeof(uint32_t);
+    // dynamic meshes, their split pieces and routing buffers
+    bytes += dynamic_meshes.capacity() * sizeof(Mesh);
+    for(const Mesh& m : dynamic_meshes)
+        bytes += m.memory_usage();
+    bytes += dynamic_mesh.memory_usage();
+    bytes += dynamic_entries.capacity() * sizeof(DynamicEntry) + dynamic_buckets.capacity() * sizeof(DynamicBucket);
+    bytes += dynamic_stack.capacity() * sizeof(dynamic_stack[0]);
+    bytes += (dynamic_vertex_frame.capacity() + dynamic_vertex_slot.capacity()) * sizeof(uint32_t);
+    return bytes;
+}
+
+void BSPTree::set_frustum_culling(bool enabled) {
+    frustum_culling = enabled;
+}
+
+bool BSPTree::get_frustum_culling() const {
+    return frustum_culling;
+}
+
+void BSPTree::set_pvs_culling(bool enabled) {
+    pvs_culling = enabled;
+}
+
+bool BSPTree::get_pvs_culling() const {
+    return pvs_culling;
+}
+
+void BSPTree::set_back_face_culling(bool enabled) {
+    back_face_culling = enabled;
+}
+
+bool BSPTree::get_back_face_culling() const {
+    return back_face_culling;
+}
+
+// front to back falls back to back to front on targets without coverage buffer
+void BSPTree::set_draw_order(DrawOrder order) {
+    draw_order = order;
 }
 
-void BSPTree::draw(Vcam camera) const {
-    draw(camera, root);
+DrawOrder BSPTree::get_draw_order() const {
+    return draw_order;
 }
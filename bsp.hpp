@@ -2,47 +2,312 @@
 #define BSP_HPP
 
 #include "include/raylib.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include "util.hpp"
+#include "mesh.hpp"
+#include "batch.hpp"
+#include "render.hpp"
+#include "transform.hpp"
+#include "mapfile.hpp"
 
+enum class SplitterStrategy {
+    // first triangle in the list
+    FIRST,
+    // best scored of sampled candidates
+    SAMPLED,
+    // axis aligned candidates first, for box heavy scenes
+    AXIS_ALIGNED
+};
+
+enum class DrawOrder {
+    // painter's algorithm, works on every render target
+    BACK_TO_FRONT,
+    // nearest first, skips covered subtrees, needs target with coverage buffer
+    FRONT_TO_BACK
+};
+
+struct BSPStats {
+    int depth;
+    int node_count;
+    int split_count;
+    int vertex_count;
+    double build_time;
+    // compressed potentially visible set with its offsets, 0 without one
+    size_t pvs_bytes;
+    double pvs_build_time;
+};
+
+// counts of last draw
+struct BSPDrawStats {
+    // triangles sent to render target, dynamic pieces included
+    int drawn;
+    // tree triangles not drawn, culled or hidden
+    int culled;
+    // triangles cut at near or far plane
+    int clipped;
+    // dynamic triangles split by tree planes
+    int dynamic_splits;
+};
+
+// index of missing child
+const uint32_t BSP_NO_NODE = UINT32_MAX;
+
+// verticies closer than this to a splitting plane count as on it, in scene units
+// keeps rounding from cutting slivers off nearly coplanar triangles
+const float BSP_PLANE_THICKNESS = 1e-4f;
+
+// node i of the tree draws triangle i of the tree mesh
 class BSPNode {
 public:
-    Triangle* triangle;
-    Vector3 triangle_normal;
-    Vector3 point_on_triangle;
-    BSPNode* behind;
-    BSPNode* front;
+    Vector4 plane;
+    uint32_t behind;
+    uint32_t front;
+    // bounding box of node triangle and whole subtree
+    Vector3 bounds_min;
+    Vector3 bounds_max;
 
-    BSPNode(Triangle* triangle);
+    BSPNode(Vector4 plane);
 
     bool camera_in_front(const Vcam& camera) const;
 };
 
+// arrays draw reads, owned by tree or inside mapped tree file
+struct BSPTreeView {
+    const BSPNode* nodes;
+    // triangle i belongs to node i
+    IndexedTriangle* triangles;
+    const Vector3* verticies;
+    uint32_t node_count;
+    uint32_t vertex_count;
+    // potentially visible set, one compressed bit row per child slot, NULL without one
+    // row of slot s is pvs_data from pvs_offsets[s] to pvs_offsets[s + 1]
+    const uint32_t* pvs_offsets;
+    const uint8_t* pvs_data;
+};
+
 class BSPTree {
 private:
-    BSPNode* root;
+    // dynamic triangle piece waiting in an empty child slot of the static tree
+    // slot is 2 * node + 1 for front child, 2 * node for behind child
+    struct DynamicEntry {
+        uint32_t slot;
+        bool facing_camera;
+        float distance;
+        uint32_t triangle;
+    };
+
+    // range of dynamic entries in one slot
+    struct DynamicBucket {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // storage of built trees, empty for loaded ones
+    std::vector<BSPNode> nodes;
+    // shared verticies, split pieces add only the new intersection points
+    Mesh mesh;
+    std::unique_ptr<MappedFile> mapped_file;
+    BSPTreeView view;
+    // reused by draw, holds node indices still to visit
+    mutable std::vector<uint32_t> draw_stack;
+    // reused by draw, visible nodes in painter's order
+    mutable std::vector<uint32_t> draw_list;
+    // transformed vertex cache, vertex_slot is valid when vertex_frame is current frame
+    mutable uint32_t frame;
+    mutable std::vector<uint32_t> vertex_frame;
+    mutable std::vector<uint32_t> vertex_slot;
+    // reused by draw, vertex buffer slot of every draw list triangle corner
+    mutable std::vector<uint32_t> draw_slots;
+    // reused by draw, unique verticies of draw list triangles
+    mutable VertexBuffer vertex_buffer;
+    // reused by draw, visible triangles in painter's order
+    mutable TriangleBatch batch;
+    // moving meshes kept out of the tree, empty after remove
+    std::vector<Mesh> dynamic_meshes;
+    // reused by draw, dynamic meshes and pieces split by static planes
+    mutable Mesh dynamic_mesh;
+    // reused by draw, pieces sorted by slot, facing away first, then far first
+    mutable std::vector<DynamicEntry> dynamic_entries;
+    mutable std::vector<DynamicBucket> dynamic_buckets;
+    // reused by draw, node and dynamic triangle pairs still to route
+    mutable std::vector<std::pair<uint32_t, uint32_t>> dynamic_stack;
+    // nodes crossed by dynamic triangles and slot buckets, valid when stamp is dynamic_frame
+    mutable uint32_t dynamic_frame;
+    mutable std::vector<uint32_t> dynamic_node_frame;
+    mutable std::vector<uint32_t> dynamic_slot_frame;
+    mutable std::vector<uint32_t> dynamic_slot_bucket;
+    // transformed vertex cache of dynamic mesh, same as for tree verticies
+    mutable std::vector<uint32_t> dynamic_vertex_frame;
+    mutable std::vector<uint32_t> dynamic_vertex_slot;
+    // built potentially visible set, empty for loaded ones and trees without it
+    std::vector<uint32_t> pvs_offsets;
+    std::vector<uint8_t> pvs_data;
+    // camera slot of decoded row, pvs_nodes marks nodes with a visible leaf below them
+    mutable uint32_t pvs_slot;
+    mutable std::vector<uint8_t> pvs_row;
+    mutable std::vector<uint8_t> pvs_nodes;
+    bool pvs_culling;
+    SplitterStrategy strategy;
+    int sample_count;
+    float plane_thickness;
+    bool frustum_culling;
+    bool back_face_culling;
+    DrawOrder draw_order;
+    BSPStats stats;
+    mutable BSPDrawStats draw_stats;
+
+    // build time state shared by build threads, defined in bsp.cpp
+    struct BuildContext;
 
     int line_intersection_with_plane(Vector3 p1, Vector3 p2, Vector4 plane, Vector3* out_point) const;
 
-    // split triangle using plane
-    void split(Triangle* t, Vector4 plane, std::vector<Triangle*>& triangles);
+    // vertex where plane crosses edge, shared by triangles on both sides of the edge
+    int edge_intersection(BuildContext& build, uint32_t v1, uint32_t v2, const Vector4& plane, uint32_t* out_vertex) const;
+
+    // split triangle using plane, pieces go to the bucket on their side
+    // sides are classify_verticies flags of the triangle corners
+    void split(BuildContext& build, uint32_t t, const Vector4& plane, const uint8_t* sides, std::vector<uint32_t>& front_triangles, std::vector<uint32_t>& behind_triangles) const;
+
+    // classify every triangle once, triangles keeps the behind bucket
+    void partition(BuildContext& build, const Vector4& plane, std::vector<uint32_t>& triangles, std::vector<uint32_t>& front_triangles) const;
+
+    bool is_axis_aligned(BuildContext& build, uint32_t triangle) const;
+
+    // lower is better, splits weigh more than front/behind imbalance
+    // corners are gathered verticies of triangles, 3 per triangle
+    int splitter_score(BuildContext& build, uint32_t splitter, const std::vector<uint32_t>& triangles, const VertexArrays& corners) const;
+
+    // move chosen splitter to the back of the list
+    void choose_splitter(BuildContext& build, std::vector<uint32_t>& triangles) const;
+
+    // subtrees with more triangles are built as parallel tasks
+    void make_bsp_tree(BuildContext& build, uint32_t node, std::vector<uint32_t>& triangles, int depth) const;
+
+    void build(const Mesh& scene_mesh, int build_threads);
+
+    // nodes in depth first order, mesh triangle i belongs to node i
+    // verticies in order of first use
+    void flatten(BuildContext& build, uint32_t root);
+
+    // children come after parents, so walk nodes backwards
+    void compute_bounds();
+
+    // sizes per frame buffers for current view
+    void prepare_draw();
+
+    // split dynamic triangle by plane, returns piece count
+    // thickness is in units of plane equation, verticies within it count as on plane
+    int split_dynamic(uint32_t triangle, const Vector4& plane, float thickness, uint32_t* out_pieces, bool* out_front) const;
+
+    // push dynamic triangles down the tree into empty child slots and depth sort each slot
+    void route_dynamic(const Vcam& camera) const;
+
+    // static bounds do not cover dynamic triangles routed through node
+    bool has_dynamic(uint32_t node) const;
+
+    // pushes child, or dynamic bucket waiting in its empty slot
+    void push_child(uint32_t node, bool front) const;
 
-    std::vector<Triangle*> find_front(Triangle* triangle, std::vector<Triangle*>& triangles) const;
+    // appends dynamic triangles of bucket to draw list
+    void add_dynamic_bucket(uint32_t bucket, bool far_first) const;
 
-    std::vector<Triangle*> find_behind(Triangle* triangle, std::vector<Triangle*>& triangles) const;
+    // empty child slot holding point, same side rule as camera_in_front
+    uint32_t find_slot(Vector3 point) const;
 
-    void make_bsp_tree(BSPNode* node, std::vector<Triangle*>& triangles);
+    bool pvs_active() const;
 
-    void draw(const Vcam& camera, BSPNode* node) const;
+    bool slot_in_pvs(uint32_t slot) const;
 
-    void restore_triangles(std::vector<Triangle*>& triangles);
-    
-    void restore_triangles(BSPNode* node, std::vector<Triangle*>& triangles);
+    // decodes row of camera leaf and marks nodes above its visible leaves, only when leaf changed
+    void update_pvs(const Vcam& camera) const;
+
+    // draw list entry to triangle, dynamic entries have DYNAMIC_DRAW_BIT set
+    const IndexedTriangle& draw_triangle(uint32_t entry) const;
+
+    // back to front walk, fills draw list
+    void collect_draw_list(const Vcam& camera) const;
+
+    // transform each vertex of draw list once and fill batch
+    void fill_batch(const Vcam& camera) const;
+
+    // screen rectangle of node bounds, false if bounds reach past near plane
+    bool screen_bounds(const BSPNode& node, const Matrix& view_project, int* min_x, int* min_y, int* max_x, int* max_y) const;
+
+    // front to back walk, drawn in chunks so covered subtrees can be skipped
+    void draw_front_to_back(const Vcam& camera, RenderTarget& target) const;
 
 public:
-    BSPTree(std::vector<Triangle*>& triangles);
+    // empty tree, for load
+    BSPTree();
+
+    // 0 build threads uses every hardware thread
+    // 0 plane thickness classifies by exact side of unnormalized planes, as builds did before it was added
+    BSPTree(const Mesh& mesh, SplitterStrategy strategy = SplitterStrategy::SAMPLED, int sample_count = 8, int build_threads = 0, float plane_thickness = BSP_PLANE_THICKNESS);
+
+    // tree copies given triangles, caller keeps ownership of them
+    BSPTree(const std::vector<Triangle*>& triangles, SplitterStrategy strategy = SplitterStrategy::SAMPLED, int sample_count = 8, int build_threads = 0, float plane_thickness = BSP_PLANE_THICKNESS);
+
+    void draw(Vcam camera, RenderTarget& target) const;
+
+    // copy of triangles and verticies after splitting, triangle i belongs to node i
+    Mesh get_mesh() const;
+
+    // versioned binary file, arrays are laid out as in memory so load can use them in place
+    bool save(const char* path) const;
+
+    // maps file and draws straight from it, false if file is missing or not a valid tree
+    bool load(const char* path);
+
+    size_t triangle_count() const;
+
+    // moving mesh drawn with the tree, split into its leaves every draw instead of rebuilding
+    // returns id for update and remove
+    size_t add_dynamic_mesh(const Mesh& mesh);
+
+    void update_dynamic_mesh(size_t id, const Mesh& mesh);
+
+    void remove_dynamic_mesh(size_t id);
+
+    void set_triangle_visible(size_t triangle, bool visible);
+
+    // offline pass, leaves are the empty child slots of the tree
+    // rays cast from sample points in every leaf mark the leaves they pass before hitting a triangle
+    // a leaf stops casting at rays_per_leaf or once its rays stop finding new leaves
+    // draw then walks only subtrees with a leaf visible from camera leaf
+    // sampled, so leaves seen only through gaps no ray found can be missing
+    void build_pvs(int rays_per_leaf = 1024, int build_threads = 0);
+
+    bool has_pvs() const;
+
+    BSPStats get_stats() const;
+
+    BSPDrawStats get_draw_stats() const;
+
+    // bytes of tree arrays and per frame draw buffers, mapped tree file counted whole
+    size_t memory_usage() const;
+
+    // skip subtrees outside of camera frustum
+    void set_frustum_culling(bool enabled);
+
+    bool get_frustum_culling() const;
+
+    // skip subtrees outside of potentially visible set of camera leaf, no effect without one
+    void set_pvs_culling(bool enabled);
+
+    bool get_pvs_culling() const;
+
+    // closed mesh mode, skip triangles facing away from camera
+    // triangles must be counter clockwise seen from outside
+    void set_back_face_culling(bool enabled);
+
+    bool get_back_face_culling() const;
+
+    // front to back falls back to back to front on targets without coverage buffer
+    void set_draw_order(DrawOrder order);
 
-    void draw(Vcam camera) const;
+    DrawOrder get_draw_order() const;
 };
 
 #endif
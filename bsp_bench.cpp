@@ -0,0 +1,88 @@
+#include "include/raylib.h"
+#include "include/raymath.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.hpp"
+#include "bsp.hpp"
+#include "cube.hpp"
+
+// BSP build microbenchmark on random triangle soups and cube scenes
+// usage: bsp_bench [triangle count|grid size|rooms size]...
+// grid8 is 8^3 cubes, rooms8 is 8x8 rooms, a number is a soup of that many triangles
+// every build runs with exact and default plane thickness, on one thread and on all hardware threads
+
+// every triangle has its own verticies
+Mesh init_random_triangles(int count) {
+    Mesh triangles;
+    triangles.verticies.reserve(count * 3);
+    triangles.triangles.reserve(count);
+    for(int i = 0; i < count; i++) {
+        Vector3 center = get_random_vector(-50.0f, 50.0f);
+        uint32_t v1 = triangles.add_vertex(Vector3Add(center, get_random_vector(-1.0f, 1.0f)));
+        uint32_t v2 = triangles.add_vertex(Vector3Add(center, get_random_vector(-1.0f, 1.0f)));
+        uint32_t v3 = triangles.add_vertex(Vector3Add(center, get_random_vector(-1.0f, 1.0f)));
+        triangles.add_triangle(v1, v2, v3, get_random_color());
+    }
+
+    return triangles;
+}
+
+const char* strategy_name(SplitterStrategy strategy) {
+    switch(strategy) {
+        case SplitterStrategy::FIRST: return "first";
+        case SplitterStrategy::SAMPLED: return "sampled";
+        case SplitterStrategy::AXIS_ALIGNED: return "axis_aligned";
+    }
+    return "unknown";
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> scenes;
+    for(int i = 1; i < argc; i++)
+        scenes.push_back(argv[i]);
+    if(scenes.empty())
+        scenes = {"10000", "50000", "100000", "grid8", "rooms8"};
+
+    SplitterStrategy strategies[] = {
+        SplitterStrategy::FIRST, SplitterStrategy::SAMPLED, SplitterStrategy::AXIS_ALIGNED
+    };
+
+    std::vector<int> thread_counts = {1};
+    int hardware_threads = std::thread::hardware_concurrency();
+    if(hardware_threads > 1)
+        thread_counts.push_back(hardware_threads);
+
+    float thicknesses[] = {0.0f, BSP_PLANE_THICKNESS};
+
+    printf("%-10s %-10s %-14s %10s %8s %12s %10s %8s %10s %12s\n", "scene", "triangles", "strategy", "thickness", "threads", "build_ms", "nodes", "depth", "splits", "tris/s");
+    for(const auto& scene : scenes) {
+        for(auto strategy : strategies) {
+            srand(1);
+            Mesh triangles;
+            if(strncmp(scene.c_str(), "grid", 4) == 0)
+                triangles = cube_grid_mesh(atoi(scene.c_str() + 4));
+            else if(strncmp(scene.c_str(), "rooms", 5) == 0)
+                triangles = rooms_mesh(atoi(scene.c_str() + 5));
+            else
+                triangles = init_random_triangles(atoi(scene.c_str()));
+            size_t count = triangles.triangles.size();
+            for(float thickness : thicknesses) {
+                for(int threads : thread_counts) {
+                    BSPTree bsp_tree = BSPTree(triangles, strategy, 8, threads, thickness);
+                    BSPStats stats = bsp_tree.get_stats();
+                    printf("%-10s %-10zu %-14s %10g %8d %12.2f %10d %8d %10d %12.0f\n",
+                        scene.c_str(), count, strategy_name(strategy), thickness, threads, stats.build_time * 1000.0,
+                        stats.node_count, stats.depth, stats.split_count, count / stats.build_time);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "include/raylib.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "cube.hpp"
+#include "bsp.hpp"
+#include "loader.hpp"
+
+// builds BSP tree offline and saves it for BSPTree::load
+// usage: bsp_build output.bsp [grid size|rooms size|model.obj|model.ply] [first|sampled|axis_aligned] [PVS rays per leaf]
+// scene is grid size^3 cubes, 3 is the vcam scene, rooms8 is 8x8 rooms, or a model file
+// PVS is built and saved with tree only when rays per leaf is given and not 0
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s output.bsp [grid size|rooms size|model.obj|model.ply] [first|sampled|axis_aligned] [PVS rays per leaf]\n", argv[0]);
+        return 1;
+    }
+    const char* output = argv[1];
+    SplitterStrategy strategy = SplitterStrategy::AXIS_ALIGNED;
+    if(argc > 3 && strcmp(argv[3], "first") == 0)
+        strategy = SplitterStrategy::FIRST;
+    else if(argc > 3 && strcmp(argv[3], "sampled") == 0)
+        strategy = SplitterStrategy::SAMPLED;
+
+    srand(1);
+    Mesh scene_mesh;
+    const char* extension = argc > 2 ? strrchr(argv[2], '.') : NULL;
+    if(extension != NULL) {
+        LoadStats load_stats;
+        if(!load_mesh(argv[2], &scene_mesh, &load_stats)) {
+            fprintf(stderr, "cannot load %s\n", argv[2]);
+            return 1;
+        }
+        printf("load: %.3f ms, %.1f MB/s, %zu verticies, %zu triangles\n",
+            load_stats.load_time * 1000.0, load_stats.bytes / load_stats.load_time / 1e6,
+            load_stats.vertex_count, load_stats.triangle_count);
+    }
+    else if(argc > 2 && strncmp(argv[2], "rooms", 5) == 0)
+        scene_mesh = rooms_mesh(atoi(argv[2] + 5));
+    else
+        scene_mesh = cube_grid_mesh(argc > 2 ? atoi(argv[2]) : 3);
+
+    BSPTree bsp_tree = BSPTree(scene_mesh, strategy);
+    BSPStats stats = bsp_tree.get_stats();
+    printf("BSP build: %.3f ms, %d nodes, depth %d, %d splits, %d verticies\n",
+        stats.build_time * 1000.0, stats.node_count, stats.depth, stats.split_count, stats.vertex_count);
+
+    int pvs_rays = argc > 4 ? atoi(argv[4]) : 0;
+    if(pvs_rays > 0) {
+        bsp_tree.build_pvs(pvs_rays);
+        stats = bsp_tree.get_stats();
+        printf("PVS build: %.3f ms, %zu bytes\n", stats.pvs_build_time * 1000.0, stats.pvs_bytes);
+    }
+
+    if(!bsp_tree.save(output)) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+    printf("tree written to %s\n", output);
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "include/raylib.h"
+#include "include/raymath.h"
+#include <cstdio>
+#include <vector>
+#include "camera_path.hpp"
+
+CameraKey camera_key(const Vcam& camera) {
+    return (CameraKey){camera.get_pos(), camera.get_target(), camera.get_up()};
+}
+
+Vcam key_camera(const CameraKey& key, Matrix projection_matrix) {
+    return Vcam(key.pos, key.up, key.target, projection_matrix);
+}
+
+// text file, one frame per line: pos xyz, target xyz, up xyz
+// lines starting with # are comments
+bool load_camera_path(const char* path, std::vector<CameraKey>* out_path) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL)
+        return false;
+
+    std::vector<CameraKey> camera_path;
+    char line[512];
+    bool ok = true;
+    while(ok && fgets(line, sizeof(line), file) != NULL) {
+        CameraKey key;
+        char rest;
+        int read = sscanf(line, " %f %f %f %f %f %f %f %f %f %c",
+            &key.pos.x, &key.pos.y, &key.pos.z,
+            &key.target.x, &key.target.y, &key.target.z,
+            &key.up.x, &key.up.y, &key.up.z, &rest);
+        if(read == 9)
+            camera_path.push_back(key);
+        // blank line or comment
+        else if(read > 0 || (sscanf(line, " %c", &rest) == 1 && rest != '#'))
+            ok = false;
+    }
+    fclose(file);
+
+    if(!ok || camera_path.empty())
+        return false;
+    *out_path = std::move(camera_path);
+    return true;
+}
+
+bool save_camera_path(const char* path, const std::vector<CameraKey>& camera_path) {
+    FILE* file = fopen(path, "w");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "# pos xyz, target xyz, up xyz\n");
+    for(const CameraKey& key : camera_path)
+        fprintf(file, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+            key.pos.x, key.pos.y, key.pos.z,
+            key.target.x, key.target.y, key.target.z,
+            key.up.x, key.up.y, key.up.z);
+    return fclose(file) == 0;
+}
+
+// camera at origin swaying left and right over the cube grid, as headless does
+std::vector<CameraKey> sway_camera_path(int frames) {
+    Vcam camera = Vcam((Vector3){0.0f, 0.0f, 0.0f}, (Vector3){0.0f, 1.0f, 0.0f}, (Vector3){0.0f, 0.0f, -1.0f}, MatrixIdentity());
+    std::vector<CameraKey> camera_path;
+    camera_path.reserve(frames);
+    for(int i = 0; i < frames; i++) {
+        camera.yaw(i % 240 < 120 ? 0.005f : -0.005f);
+        camera_path.push_back(camera_key(camera));
+    }
+    return camera_path;
+}
@@ -0,0 +1,28 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include "include/raylib.h"
+#include <vector>
+#include "util.hpp"
+
+// camera of one frame, target is view direction as in Vcam
+struct CameraKey {
+    Vector3 pos;
+    Vector3 target;
+    Vector3 up;
+};
+
+CameraKey camera_key(const Vcam& camera);
+
+Vcam key_camera(const CameraKey& key, Matrix projection_matrix);
+
+// text file, one frame per line: pos xyz, target xyz, up xyz
+// lines starting with # are comments
+bool load_camera_path(const char* path, std::vector<CameraKey>* out_path);
+
+bool save_camera_path(const char* path, const std::vector<CameraKey>& camera_path);
+
+// camera at origin swaying left and right over the cube grid, as headless does
+std::vector<CameraKey> sway_camera_path(int frames);
+
+#endif
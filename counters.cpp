@@ -0,0 +1,141 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "counters.hpp"
+
+FrameCounters frame_counters = {};
+// ring of recorded frames once limit is reached, history_start is the oldest
+static std::vector<FrameCounters> history;
+static size_t history_limit = 0;
+static size_t history_start = 0;
+// frames overwritten since reset, numbers of written frames start after them
+static size_t dropped_frames = 0;
+// running timer and when it was last charged
+static Timer current_timer = Timer::NONE;
+static std::chrono::steady_clock::time_point timer_mark;
+
+const char* counter_name(Counter counter) {
+    switch(counter) {
+        case Counter::NODES_VISITED: return "nodes_visited";
+        case Counter::TRIANGLES_SUBMITTED: return "triangles_submitted";
+        case Counter::TRIANGLES_CLIPPED: return "triangles_clipped";
+        case Counter::TRIANGLES_REJECTED: return "triangles_rejected";
+        case Counter::VERTICIES_TRANSFORMED: return "verticies_transformed";
+        default: return "unknown";
+    }
+}
+
+const char* timer_name(Timer timer) {
+    switch(timer) {
+        case Timer::UPDATE: return "update_ms";
+        case Timer::TRAVERSAL: return "traversal_ms";
+        case Timer::SUBMISSION: return "submission_ms";
+        default: return "unknown";
+    }
+}
+
+// recorded frame i, oldest first
+static const FrameCounters& history_frame(size_t i) {
+    return history[(history_start + i) % history.size()];
+}
+
+void counters_end_frame() {
+    if(history_limit == 0 || history.size() < history_limit)
+        history.push_back(frame_counters);
+    else {
+        history[history_start] = frame_counters;
+        history_start = (history_start + 1) % history.size();
+        dropped_frames++;
+    }
+    memset(&frame_counters, 0, sizeof(frame_counters));
+}
+
+void counters_reset() {
+    history.clear();
+    history_start = 0;
+    dropped_frames = 0;
+    memset(&frame_counters, 0, sizeof(frame_counters));
+}
+
+// keeps only the newest frames, oldest are overwritten, 0 keeps every frame
+void counters_set_history_limit(size_t frames) {
+    counters_reset();
+    history_limit = frames;
+}
+
+std::vector<FrameCounters> counters_history() {
+    std::vector<FrameCounters> frames;
+    frames.reserve(history.size());
+    for(size_t i = 0; i < history.size(); i++)
+        frames.push_back(history_frame(i));
+    return frames;
+}
+
+FrameCounters counters_last_frame() {
+    if(history.empty()) {
+        FrameCounters empty = {};
+        return empty;
+    }
+    return history_frame(history.size() - 1);
+}
+
+// charges time since last mark to running timer
+static void charge_timer() {
+    auto now = std::chrono::steady_clock::now();
+    if(current_timer != Timer::NONE)
+        frame_counters.times[(int)current_timer] += std::chrono::duration<double>(now - timer_mark).count();
+    timer_mark = now;
+}
+
+CounterScope::CounterScope(Timer timer) {
+    charge_timer();
+    outer = current_timer;
+    current_timer = timer;
+}
+
+CounterScope::~CounterScope() {
+    charge_timer();
+    current_timer = outer;
+}
+
+bool counters_write_csv(const char* path) {
+    FILE* file = fopen(path, "w");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "frame");
+    for(int i = 0; i < (int)Counter::COUNT; i++)
+        fprintf(file, ",%s", counter_name((Counter)i));
+    for(int i = 0; i < (int)Timer::COUNT; i++)
+        fprintf(file, ",%s", timer_name((Timer)i));
+    fprintf(file, "\n");
+
+    for(size_t frame = 0; frame < history.size(); frame++) {
+        fprintf(file, "%zu", dropped_frames + frame);
+        for(int i = 0; i < (int)Counter::COUNT; i++)
+            fprintf(file, ",%lld", (long long)history_frame(frame).counts[i]);
+        for(int i = 0; i < (int)Timer::COUNT; i++)
+            fprintf(file, ",%.4f", history_frame(frame).times[i] * 1000.0);
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+bool counters_write_json(const char* path) {
+    FILE* file = fopen(path, "w");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "[\n");
+    for(size_t frame = 0; frame < history.size(); frame++) {
+        fprintf(file, "{\"frame\":%zu", dropped_frames + frame);
+        for(int i = 0; i < (int)Counter::COUNT; i++)
+            fprintf(file, ",\"%s\":%lld", counter_name((Counter)i), (long long)history_frame(frame).counts[i]);
+        for(int i = 0; i < (int)Timer::COUNT; i++)
+            fprintf(file, ",\"%s\":%.4f", timer_name((Timer)i), history_frame(frame).times[i] * 1000.0);
+        fprintf(file, "}%s\n", frame + 1 < history.size() ? "," : "");
+    }
+    fprintf(file, "]\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,104 @@
+#ifndef COUNTERS_HPP
+#define COUNTERS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// per frame instrumentation, built in with make COUNTERS=1 (-DVCAM_COUNTERS)
+// without it the COUNTER_ macros expand to nothing and no frames are recorded
+// counts and timers are for the main thread, not the rasterizer pool
+
+#ifdef VCAM_COUNTERS
+const bool COUNTERS_ENABLED = true;
+#else
+const bool COUNTERS_ENABLED = false;
+#endif
+
+enum class Counter {
+    // bsp nodes popped by the draw walk, culled ones included
+    NODES_VISITED,
+    // screen triangles sent to render target, clipped pieces included
+    TRIANGLES_SUBMITTED,
+    // triangles crossing near or far plane that were clipped
+    TRIANGLES_CLIPPED,
+    // triangles fully outside of near and far planes
+    TRIANGLES_REJECTED,
+    VERTICIES_TRANSFORMED,
+    COUNT
+};
+
+enum class Timer {
+    // camera and scene changes before draw
+    UPDATE,
+    // bsp walk and dynamic mesh routing
+    TRAVERSAL,
+    // vertex transform, batch fill and render target draw
+    SUBMISSION,
+    COUNT,
+    NONE = COUNT
+};
+
+struct FrameCounters {
+    int64_t counts[(int)Counter::COUNT];
+    // seconds, each timer excludes timers nested in it
+    double times[(int)Timer::COUNT];
+};
+
+const char* counter_name(Counter counter);
+
+const char* timer_name(Timer timer);
+
+// counters of frame in progress, global so hot paths add without a call
+extern FrameCounters frame_counters;
+
+// stores frame in progress and starts new one
+void counters_end_frame();
+
+// drops recorded frames and frame in progress
+void counters_reset();
+
+// keeps only the newest frames, oldest are overwritten, 0 keeps every frame
+// bounds memory of long interactive sessions
+void counters_set_history_limit(size_t frames);
+
+// recorded frames, oldest first
+std::vector<FrameCounters> counters_history();
+
+// last finished frame, zeros before first one
+FrameCounters counters_last_frame();
+
+// one row or object per recorded frame, false if file cannot be written
+bool counters_write_csv(const char* path);
+
+bool counters_write_json(const char* path);
+
+// times the enclosing block into one timer, nested scope pauses outer one
+class CounterScope {
+private:
+    Timer outer;
+
+public:
+    CounterScope(Timer timer);
+
+    ~CounterScope();
+
+    CounterScope(const CounterScope&) = delete;
+    CounterScope& operator=(const CounterScope&) = delete;
+};
+
+#ifdef VCAM_COUNTERS
+#define COUNTER_CONCAT_(a, b) a##b
+#define COUNTER_CONCAT(a, b) COUNTER_CONCAT_(a, b)
+#define COUNTER_ADD(counter, n) (frame_counters.counts[(int)Counter::counter] += (n))
+#define COUNTER_SCOPE(timer) CounterScope COUNTER_CONCAT(counter_scope_, __LINE__)(Timer::timer)
+#define COUNTER_END_FRAME() counters_end_frame()
+#else
+// sizeof keeps arguments used without evaluating them
+#define COUNTER_ADD(counter, n) ((void)sizeof(n))
+#define COUNTER_SCOPE(timer) ((void)0)
+#define COUNTER_END_FRAME() ((void)0)
+#endif
+
+#endif
@@ -1,13 +1,10 @@
 #include "include/raylib.h"
 #include "util.hpp"
 #include "cube.hpp"
+#include "mesh.hpp"
 #include "include/raymath.h"
 #include <vector>
 
-bool Cube::z_in_range(float z) const {
-    return z > 0 && z <= 1;
-}
-
 Cube::Cube(Vector3 center, float side_size) {
     this->center = center;
     this->side_size = side_size;
@@ -22,38 +19,19 @@ void Cube::rotate(Quaternion& q) {
         verticies[i] = Vector3RotateByQuaternion(verticies[i], q);
 }
 
-void Cube::draw(Matrix& project_matrix) const {
-    Vector3 projected_verticies[8] = {0};
-    Vector2 projected_screen_verticies[8] = {0};
+void Cube::draw(Matrix& project_matrix, TriangleBatch& batch) const {
+    Vector4 clip_verticies[8];
     
-    for(int i = 0; i < 8; i++) {
-        projected_verticies[i] = multiply_mv(project_matrix, verticies[i]);
-        projected_screen_verticies[i] = get_2d_screen_vec(projected_verticies[i]);
-    }
+    for(int i = 0; i < 8; i++)
+        clip_verticies[i] = multiply_mv4(project_matrix, verticies[i]);
 
     for(int i = 0; i < 36; i+=3) {
-        // double draw to ommit clock wise triangle drawing
-        if(z_in_range(projected_verticies[triangles[i]].z) && 
-            z_in_range(projected_verticies[triangles[i+1]].z &&
-                z_in_range(projected_verticies[triangles[i+2]].z)))
-
-            DrawTriangle(
-                projected_screen_verticies[triangles[i]],
-                projected_screen_verticies[triangles[i+1]],
-                projected_screen_verticies[triangles[i+2]],
-                colors[i/3]
-            );
-
-        if(z_in_range(projected_verticies[triangles[35-i]].z) &&
-            z_in_range(projected_verticies[triangles[35-i-1]].z &&
-                z_in_range(projected_verticies[triangles[35-i-2]].z)))
-
-            DrawTriangle(
-                projected_screen_verticies[triangles[35-i]],
-                projected_screen_verticies[triangles[35-i-1]],
-                projected_screen_verticies[triangles[35-i-2]],
-                colors[12-i/3]
-            );
+        Vector4 triangle_verticies[3] = {
+            clip_verticies[triangles[i]],
+            clip_verticies[triangles[i+1]],
+            clip_verticies[triangles[i+2]]
+        };
+        draw_clipped_triangle(triangle_verticies, colors[i/3], batch);
     }
 }
 
@@ -71,12 +49,13 @@ void Cube::set_verticies(Vector3 center) {
     verticies[7] = (Vector3){center.x-side_size, center.y+side_size, center.z+side_size};
 }
 
+// counter clockwise seen from outside, to_plane normals point out
 void Cube::set_triangles() {
-    triangles[0] = 0; triangles[1] = 1; triangles[2] = 2;
-    triangles[3] = 2; triangles[4] = 3; triangles[5] = 0;
+    triangles[0] = 0; triangles[1] = 2; triangles[2] = 1;
+    triangles[3] = 2; triangles[4] = 0; triangles[5] = 3;
 
-    triangles[6] = 1; triangles[7] = 5; triangles[8] = 6;
-    triangles[9] = 6; triangles[10] = 2; triangles[11] = 1;
+    triangles[6] = 1; triangles[7] = 6; triangles[8] = 5;
+    triangles[9] = 6; triangles[10] = 1; triangles[11] = 2;
 
     triangles[12] = 4; triangles[13] = 5; triangles[14] = 6;
     triangles[15] = 6; triangles[16] = 7; triangles[17] = 4;
@@ -84,8 +63,8 @@ void Cube::set_triangles() {
     triangles[18] = 0; triangles[19] = 4; triangles[20] = 7;
     triangles[21] = 7; triangles[22] = 3; triangles[23] = 0;
 
-    triangles[24] = 3; triangles[25] = 2; triangles[26] = 6;
-    triangles[27] = 6; triangles[28] = 7; triangles[29] = 3;
+    triangles[24] = 3; triangles[25] = 6; triangles[26] = 2;
+    triangles[27] = 6; triangles[28] = 3; triangles[29] = 7;
 
     triangles[30] = 0; triangles[31] = 1; triangles[32] = 5;
     triangles[33] = 5; triangles[34] = 4; triangles[35] = 0;
@@ -101,6 +80,16 @@ std::vector<Triangle*> Cube::get_triangles() const {
     return return_triangles;
 }
 
+Mesh Cube::get_mesh() const {
+    Mesh mesh;
+    for(int i = 0; i < 8; i++)
+        mesh.add_vertex(verticies[i]);
+    for(int i = 0; i < 36; i += 3)
+        mesh.add_triangle(triangles[i], triangles[i+1], triangles[i+2], colors[i/3]);
+
+    return mesh;
+}
+
 void Cube::set_colors() {
     for(int i = 0; i < 12; i++)
         colors[i] = get_random_color();
@@ -115,3 +104,67 @@ void Cube::multiply_by_matrix(Matrix& mat) {
         v = multiply_mv(mat, v);
 }
 
+// size^3 grid of unit cubes in front of camera at origin
+// size 3 with spacing 4 is the vcam scene
+Mesh cube_grid_mesh(int size, float spacing) {
+    Mesh grid_mesh;
+    float offset = (size - 1) * spacing / 2.0f;
+    for(int y = 0; y < size; y++)
+        for(int z = 0; z < size; z++)
+            for(int x = 0; x < size; x++)
+                grid_mesh.append(Cube({x * spacing - offset, y * spacing - offset, -10.0f - z * spacing}, 1.0f).get_mesh());
+
+    return grid_mesh;
+}
+
+// cube mesh stretched to box, keeps cube winding and colors
+static Mesh box_mesh(Vector3 min, Vector3 max) {
+    Mesh box = Cube((Vector3){0.0f, 0.0f, 0.0f}, 1.0f).get_mesh();
+    for(auto& v : box.verticies)
+        v = (Vector3){v.x < 0 ? min.x : max.x, v.y < 0 ? min.y : max.y, v.z < 0 ? min.z : max.z};
+    return box;
+}
+
+// size^2 grid of closed rooms with floor, ceiling and one doorway in every inner wall
+// doorways are shifted along walls so they do not line up, camera at origin starts in a front room
+Mesh rooms_mesh(int size) {
+    const float room = 8.0f, wall = 0.5f, height = 2.0f, door_width = 2.0f, door_height = 1.0f;
+    Mesh rooms;
+    float x0 = -(size / 2) * room - room / 2.0f;
+    float z0 = room / 2.0f;
+    auto door_shift = [](int i, int j) {
+        return ((i * 7 + j * 13) % 3 - 1) * 2.0f;
+    };
+
+    for(int i = 0; i < size; i++)
+        for(int j = 0; j < size; j++) {
+            float x = x0 + i * room, z = z0 - j * room;
+            rooms.append(box_mesh((Vector3){x, -height - wall, z - room}, (Vector3){x + room, -height, z}));
+            rooms.append(box_mesh((Vector3){x, height, z - room}, (Vector3){x + room, height + wall, z}));
+        }
+
+    // walls along z at x lines and along x at z lines, line 0 and size are outer walls
+    for(int axis = 0; axis < 2; axis++)
+        for(int line = 0; line <= size; line++)
+            for(int k = 0; k < size; k++) {
+                float across = axis == 0 ? x0 + line * room : z0 - line * room;
+                float from = axis == 0 ? z0 - (k + 1) * room : x0 + k * room;
+                float to = from + room;
+                auto add_wall = [&](float a, float b, float bottom, float top) {
+                    if(axis == 0)
+                        rooms.append(box_mesh((Vector3){across - wall / 2.0f, bottom, a}, (Vector3){across + wall / 2.0f, top, b}));
+                    else
+                        rooms.append(box_mesh((Vector3){a, bottom, across - wall / 2.0f}, (Vector3){b, top, across + wall / 2.0f}));
+                };
+                if(line == 0 || line == size) {
+                    add_wall(from - wall / 2.0f, to + wall / 2.0f, -height, height);
+                    continue;
+                }
+                float door = (from + to) / 2.0f + door_shift(line + axis * size, k);
+                add_wall(from - wall / 2.0f, door - door_width / 2.0f, -height, height);
+                add_wall(door + door_width / 2.0f, to + wall / 2.0f, -height, height);
+                add_wall(door - door_width / 2.0f, door + door_width / 2.0f, door_height, height);
+            }
+
+    return rooms;
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include "include/raylib.h"
 #include "util.hpp"
+#include "mesh.hpp"
 
 class Cube {
 private:
@@ -13,8 +14,6 @@ private:
     int triangles[12*3];
     Color colors[12];
 
-    bool z_in_range(float z) const;
-
     void set_verticies(Vector3 center);
 
     void set_triangles();
@@ -26,13 +25,23 @@ public:
 
     void rotate(Quaternion& q);
 
-    void draw(Matrix& project_matrix) const;
+    void draw(Matrix& project_matrix, TriangleBatch& batch) const;
 
     Vector3 get_center() const;
 
     std::vector<Triangle*> get_triangles() const;
 
+    // 8 shared verticies, 12 triangles
+    Mesh get_mesh() const;
+
     void multiply_by_matrix(Matrix& mat);
 };
 
+// size^3 grid of unit cubes in front of camera at origin
+// size 3 with spacing 4 is the vcam scene
+Mesh cube_grid_mesh(int size, float spacing = 4.0f);
+
+// size^2 grid of closed rooms joined by doorways, indoor scene for PVS
+Mesh rooms_mesh(int size);
+
 #endif
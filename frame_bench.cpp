@@ -0,0 +1,184 @@
+#include "include/raylib.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "util.hpp"
+#include "cube.hpp"
+#include "bsp.hpp"
+#include "render.hpp"
+#include "loader.hpp"
+#include "camera_path.hpp"
+#include "counters.hpp"
+#include "zbuffer.hpp"
+
+// replays camera path over a scene in the software target, no window, vsync or input
+// usage: frame_bench [camera path|-] [grid size|rooms size|scene.bsp|model.obj|model.ply] [threads] [back|front|zbuffer] [counters.csv|counters.json]
+// - or no path replays the headless sway, 0 threads uses every hardware thread
+// back and front draw BSP tree in that order, zbuffer draws scene mesh with depth test instead
+// saved trees with a PVS, see bsp_build, draw with PVS culling
+// per frame counters are written only in builds with counters, make COUNTERS=1
+// results go to stdout as one json line, so runs can be appended to one file and compared
+
+// frames drawn before timing starts
+const int WARMUP_FRAMES = 30;
+
+// nearest rank, sorted must not be empty
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+// scene names go into json, keep them free of quotes and backslashes
+static std::string json_safe(const char* text) {
+    std::string safe;
+    for(const char* c = text; *c != '\0'; c++)
+        if(*c != '"' && *c != '\\' && (unsigned char)*c >= 0x20)
+            safe += *c;
+    return safe;
+}
+
+int main(int argc, char** argv) {
+    const char* path_file = argc > 1 && strcmp(argv[1], "-") != 0 ? argv[1] : NULL;
+    const char* scene = argc > 2 ? argv[2] : "3";
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    const char* mode = argc > 4 ? argv[4] : "back";
+    bool front_to_back = strcmp(mode, "front") == 0;
+    bool zbuffer = strcmp(mode, "zbuffer") == 0;
+    if(!front_to_back && !zbuffer && strcmp(mode, "back") != 0) {
+        fprintf(stderr, "unknown mode %s, use back, front or zbuffer\n", mode);
+        return 1;
+    }
+    const char* counters_output = argc > 5 ? argv[5] : NULL;
+    if(counters_output != NULL && !COUNTERS_ENABLED) {
+        fprintf(stderr, "counters are not built in, use make COUNTERS=1\n");
+        return 1;
+    }
+
+    std::vector<CameraKey> camera_path;
+    if(path_file == NULL)
+        camera_path = sway_camera_path(600);
+    else if(!load_camera_path(path_file, &camera_path)) {
+        fprintf(stderr, "cannot load camera path %s\n", path_file);
+        return 1;
+    }
+
+    // saved trees are drawn as loaded, meshes get a tree built or go to z-buffer as they are
+    srand(1);
+    BSPTree bsp_tree;
+    Mesh scene_mesh;
+    const char* extension = strrchr(scene, '.');
+    bool loaded = extension != NULL && strcmp(extension, ".bsp") == 0;
+    if(loaded) {
+        if(!bsp_tree.load(scene)) {
+            fprintf(stderr, "cannot load %s\n", scene);
+            return 1;
+        }
+        if(zbuffer)
+            scene_mesh = bsp_tree.get_mesh();
+    }
+    else if(extension != NULL) {
+        if(!load_mesh(scene, &scene_mesh)) {
+            fprintf(stderr, "cannot load %s\n", scene);
+            return 1;
+        }
+    }
+    else if(strncmp(scene, "rooms", 5) == 0)
+        scene_mesh = rooms_mesh(atoi(scene + 5));
+    else
+        scene_mesh = cube_grid_mesh(atoi(scene));
+
+    SplitterStrategy strategy = extension != NULL ? SplitterStrategy::SAMPLED : SplitterStrategy::AXIS_ALIGNED;
+    if(!loaded && !zbuffer)
+        bsp_tree = BSPTree(scene_mesh, strategy);
+    bsp_tree.set_draw_order(front_to_back ? DrawOrder::FRONT_TO_BACK : DrawOrder::BACK_TO_FRONT);
+    BSPStats bsp_stats = bsp_tree.get_stats();
+    ZBufferScene zbuffer_scene = ZBufferScene(zbuffer ? scene_mesh : Mesh());
+    scene_mesh = Mesh();
+    auto draw = [&](const Vcam& camera, RenderTarget& target) {
+        if(zbuffer)
+            zbuffer_scene.draw(camera, target);
+        else
+            bsp_tree.draw(camera, target);
+    };
+
+    Matrix project_mat = get_project_matrix(screenWidth, screenHeight, 60.0f, 0.1f, 100.0f);
+    TiledTarget target = TiledTarget(screenWidth, screenHeight, threads);
+
+    int warmup = std::min(WARMUP_FRAMES, (int)camera_path.size());
+    for(int i = 0; i < warmup; i++) {
+        target.clear(RAYWHITE);
+        draw(key_camera(camera_path[i], project_mat), target);
+    }
+    counters_reset();
+
+    std::vector<double> frame_times;
+    frame_times.reserve(camera_path.size());
+    long long drawn = 0, culled = 0, clipped = 0, dynamic_splits = 0;
+    for(const CameraKey& key : camera_path) {
+        Vcam camera = key_camera(key, project_mat);
+        auto start = std::chrono::steady_clock::now();
+        target.clear(RAYWHITE);
+        draw(camera, target);
+        frame_times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        COUNTER_END_FRAME();
+
+        if(zbuffer) {
+            ZBufferDrawStats draw_stats = zbuffer_scene.get_draw_stats();
+            drawn += draw_stats.drawn;
+            culled += draw_stats.culled;
+            clipped += draw_stats.clipped;
+            continue;
+        }
+        BSPDrawStats draw_stats = bsp_tree.get_draw_stats();
+        drawn += draw_stats.drawn;
+        culled += draw_stats.culled;
+        clipped += draw_stats.clipped;
+        dynamic_splits += draw_stats.dynamic_splits;
+    }
+
+    double total = 0.0;
+    for(double t : frame_times)
+        total += t;
+    std::vector<double> sorted = frame_times;
+    std::sort(sorted.begin(), sorted.end());
+    double frames = frame_times.size();
+
+    // z-buffer mode has no tree, triangles and verticies are the mesh as given
+    double build_time = zbuffer ? zbuffer_scene.get_build_time() : bsp_stats.build_time;
+    int triangles = zbuffer ? zbuffer_scene.get_store().triangle_count() : bsp_stats.node_count;
+    int verticies = zbuffer ? zbuffer_scene.get_store().vertex_count() : bsp_stats.vertex_count;
+    size_t scene_bytes = zbuffer ? zbuffer_scene.memory_usage() : bsp_tree.memory_usage();
+
+    printf("{\"scene\":\"%s\",\"camera_path\":\"%s\",\"width\":%d,\"height\":%d,\"threads\":%d,\"mode\":\"%s\","
+        "\"build_ms\":%.3f,\"loaded\":%s,\"pvs\":%s,\"pvs_bytes\":%zu,\"triangles\":%d,\"depth\":%d,\"build_splits\":%d,\"verticies\":%d,"
+        "\"scene_bytes\":%zu,\"target_bytes\":%zu,"
+        "\"frames\":%zu,\"frame_ms\":{\"mean\":%.4f,\"min\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f},"
+        "\"fps\":%.2f,\"triangles_per_frame\":{\"drawn\":%.1f,\"culled\":%.1f,\"clipped\":%.1f,\"dynamic_splits\":%.1f},"
+        "\"triangles_per_s\":%.0f}\n",
+        json_safe(scene).c_str(), path_file == NULL ? "sway" : json_safe(path_file).c_str(),
+        screenWidth, screenHeight, target.thread_count(), mode,
+        build_time * 1000.0, loaded ? "true" : "false", !zbuffer && bsp_tree.has_pvs() ? "true" : "false", zbuffer ? 0 : bsp_stats.pvs_bytes,
+        triangles, zbuffer ? 0 : bsp_stats.depth, zbuffer ? 0 : bsp_stats.split_count, verticies,
+        scene_bytes, target.memory_usage(),
+        frame_times.size(), total * 1000.0 / frames, sorted.front() * 1000.0,
+        percentile(sorted, 0.50) * 1000.0, percentile(sorted, 0.95) * 1000.0, percentile(sorted, 0.99) * 1000.0, sorted.back() * 1000.0,
+        frames / total, drawn / frames, culled / frames, clipped / frames, dynamic_splits / frames,
+        drawn / total);
+
+    if(counters_output != NULL) {
+        const char* counters_extension = strrchr(counters_output, '.');
+        bool json = counters_extension != NULL && strcmp(counters_extension, ".json") == 0;
+        if(!(json ? counters_write_json(counters_output) : counters_write_csv(counters_output))) {
+            fprintf(stderr, "cannot write %s\n", counters_output);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "include/raylib.h"
+#include "include/raymath.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "util.hpp"
+#include "cube.hpp"
+#include "bsp.hpp"
+#include "render.hpp"
+#include "counters.hpp"
+
+// renders the cube scene without window into software framebuffer
+// usage: headless [frames] [output.ppm] [threads] [back|front] [scene.bsp]
+// 0 threads uses every hardware thread, front draws front to back
+// without tree file the vcam cube grid is built
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    const char* output = argc > 2 ? argv[2] : "headless.ppm";
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    bool front_to_back = argc > 4 && strcmp(argv[4], "front") == 0;
+    const char* tree_path = argc > 5 ? argv[5] : NULL;
+
+    srand(1);
+    BSPTree bsp_tree;
+    if(tree_path == NULL)
+        bsp_tree = BSPTree(cube_grid_mesh(3), SplitterStrategy::AXIS_ALIGNED);
+    else if(!bsp_tree.load(tree_path)) {
+        fprintf(stderr, "cannot load %s\n", tree_path);
+        return 1;
+    }
+    bsp_tree.set_draw_order(front_to_back ? DrawOrder::FRONT_TO_BACK : DrawOrder::BACK_TO_FRONT);
+    BSPStats bsp_stats = bsp_tree.get_stats();
+    printf("BSP %s: %.3f ms, %d nodes, depth %d, %d splits, %d verticies\n",
+        tree_path == NULL ? "build" : "load", bsp_stats.build_time * 1000.0, bsp_stats.node_count, bsp_stats.depth, bsp_stats.split_count, bsp_stats.vertex_count);
+
+    Matrix project_mat = get_project_matrix(screenWidth, screenHeight, 60.0f, 0.1f, 100.0f);
+    Vcam camera = Vcam((Vector3){0.0f, 0.0f, 0.0f}, (Vector3){0.0f, 1.0f, 0.0f}, (Vector3){0.0f, 0.0f, -1.0f}, project_mat);
+    TiledTarget target = TiledTarget(screenWidth, screenHeight, threads);
+
+    // camera sways left and right over the scene
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < frames; i++) {
+        {
+            COUNTER_SCOPE(UPDATE);
+            camera.yaw(i % 240 < 120 ? 0.005f : -0.005f);
+        }
+        target.clear(RAYWHITE);
+        bsp_tree.draw(camera, target);
+        COUNTER_END_FRAME();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%d frames %dx%d, %d threads, %s: %.3f ms/frame, %.1f fps\n",
+        frames, screenWidth, screenHeight, target.thread_count(), front_to_back ? "front to back" : "back to front", seconds * 1000.0 / std::max(frames, 1), frames / seconds);
+
+    if(!target.save_ppm(output)) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+    printf("last frame written to %s\n", output);
+
+    return 0;
+}
@@ -0,0 +1,417 @@
+#include "include/raylib.h"
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "loader.hpp"
+#include "mapfile.hpp"
+#include "util.hpp"
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skip_blank(const char* p, const char* end) {
+    while(p < end && is_blank(*p))
+        p++;
+    return p;
+}
+
+static const char* next_line(const char* p, const char* end) {
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    return newline == NULL ? end : newline + 1;
+}
+
+// mapped file is not null terminated, so no strtof
+static bool parse_float(const char*& p, const char* end, float* out) {
+    p = skip_blank(p, end);
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    double value = 0.0;
+    bool digits = false;
+    while(p < end && *p >= '0' && *p <= '9') {
+        value = value * 10.0 + (*p++ - '0');
+        digits = true;
+    }
+    if(p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while(p < end && *p >= '0' && *p <= '9') {
+            value += (*p++ - '0') * scale;
+            scale *= 0.1;
+            digits = true;
+        }
+    }
+    if(!digits)
+        return false;
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negative_exponent = false;
+        if(p < end && (*p == '-' || *p == '+'))
+            negative_exponent = *p++ == '-';
+        int exponent = 0;
+        while(p < end && *p >= '0' && *p <= '9')
+            exponent = std::min(exponent * 10 + (*p++ - '0'), 400);
+        value *= pow(10.0, negative_exponent ? -exponent : exponent);
+    }
+
+    *out = negative ? -value : value;
+    return true;
+}
+
+static bool parse_int(const char*& p, const char* end, long long* out) {
+    p = skip_blank(p, end);
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    long long value = 0;
+    bool digits = false;
+    while(p < end && *p >= '0' && *p <= '9') {
+        // anything this long is out of range anyway
+        if(value < 100000000000000LL)
+            value = value * 10 + (*p - '0');
+        p++;
+        digits = true;
+    }
+    *out = negative ? -value : value;
+    return digits;
+}
+
+static bool starts_line(const char* p, const char* end, char type) {
+    return end - p >= 2 && p[0] == type && is_blank(p[1]);
+}
+
+// one based, negative counts back from last vertex read so far
+static bool obj_vertex_index(long long index, size_t vertex_count, uint32_t* out) {
+    long long resolved = index > 0 ? index - 1 : (long long)vertex_count + index;
+    if(index == 0 || resolved < 0 || resolved >= (long long)vertex_count)
+        return false;
+    *out = resolved;
+    return true;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool load_obj(const char* path, Mesh* out_mesh, LoadStats* out_stats) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if(!file.open(path))
+        return false;
+    const char* data = (const char*)file.get_data();
+    const char* end = data + file.get_size();
+
+    // counting pass, so verticies and triangles are allocated once
+    size_t vertex_lines = 0, triangle_estimate = 0;
+    for(const char* p = data; p < end; p = next_line(p, end)) {
+        p = skip_blank(p, end);
+        if(starts_line(p, end, 'v'))
+            vertex_lines++;
+        else if(starts_line(p, end, 'f')) {
+            // corners minus two, counted by blank to non blank steps
+            const char* line_end = next_line(p, end);
+            int corners = 0;
+            for(const char* c = p + 1; c < line_end; c++)
+                if(is_blank(c[-1]) && !is_blank(*c) && *c != '\n')
+                    corners++;
+            triangle_estimate += std::max(corners - 2, 0);
+        }
+    }
+
+    Mesh mesh;
+    mesh.verticies.reserve(vertex_lines);
+    mesh.triangles.reserve(triangle_estimate);
+    for(const char* p = data; p < end; p = next_line(p, end)) {
+        p = skip_blank(p, end);
+        if(starts_line(p, end, 'v')) {
+            p += 2;
+            Vector3 vertex;
+            if(!parse_float(p, end, &vertex.x) || !parse_float(p, end, &vertex.y) || !parse_float(p, end, &vertex.z))
+                return false;
+            mesh.add_vertex(vertex);
+        }
+        else if(starts_line(p, end, 'f')) {
+            p += 2;
+            // fan around first corner, corners look like v, v/vt, v//vn or v/vt/vn
+            uint32_t first = 0, previous = 0;
+            int corners = 0;
+            long long index;
+            while(parse_int(p, end, &index)) {
+                uint32_t vertex;
+                if(!obj_vertex_index(index, mesh.verticies.size(), &vertex))
+                    return false;
+                while(p < end && !is_blank(*p) && *p != '\n')
+                    p++;
+
+                if(corners == 0)
+                    first = vertex;
+                else if(corners >= 2)
+                    mesh.add_triangle(first, previous, vertex, get_random_color());
+                previous = vertex;
+                corners++;
+            }
+        }
+    }
+
+    if(out_stats != NULL)
+        *out_stats = (LoadStats){file.get_size(), mesh.verticies.size(), mesh.triangles.size(), seconds_since(start)};
+    *out_mesh = std::move(mesh);
+    return true;
+}
+
+enum class PlyType {INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, INVALID};
+
+struct PlyProperty {
+    std::string name;
+    PlyType type;
+    // list properties store count type in count_type and item type in type
+    bool is_list;
+    PlyType count_type;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+};
+
+static PlyType ply_type(const std::string& name) {
+    if(name == "char" || name == "int8") return PlyType::INT8;
+    if(name == "uchar" || name == "uint8") return PlyType::UINT8;
+    if(name == "short" || name == "int16") return PlyType::INT16;
+    if(name == "ushort" || name == "uint16") return PlyType::UINT16;
+    if(name == "int" || name == "int32") return PlyType::INT32;
+    if(name == "uint" || name == "uint32") return PlyType::UINT32;
+    if(name == "float" || name == "float32") return PlyType::FLOAT32;
+    if(name == "double" || name == "float64") return PlyType::FLOAT64;
+    return PlyType::INVALID;
+}
+
+static size_t ply_type_size(PlyType type) {
+    switch(type) {
+        case PlyType::INT8: case PlyType::UINT8: return 1;
+        case PlyType::INT16: case PlyType::UINT16: return 2;
+        case PlyType::INT32: case PlyType::UINT32: case PlyType::FLOAT32: return 4;
+        case PlyType::FLOAT64: return 8;
+        default: return 0;
+    }
+}
+
+// reads one value and moves p past it, false at end of data
+static bool ply_read(const char*& p, const char* end, PlyType type, bool swap_bytes, double* out) {
+    size_t size = ply_type_size(type);
+    if((size_t)(end - p) < size)
+        return false;
+
+    unsigned char bytes[8];
+    memcpy(bytes, p, size);
+    if(swap_bytes)
+        for(size_t i = 0; i < size / 2; i++)
+            std::swap(bytes[i], bytes[size - 1 - i]);
+    p += size;
+
+    switch(type) {
+        case PlyType::INT8: { int8_t v; memcpy(&v, bytes, 1); *out = v; break; }
+        case PlyType::UINT8: { uint8_t v; memcpy(&v, bytes, 1); *out = v; break; }
+        case PlyType::INT16: { int16_t v; memcpy(&v, bytes, 2); *out = v; break; }
+        case PlyType::UINT16: { uint16_t v; memcpy(&v, bytes, 2); *out = v; break; }
+        case PlyType::INT32: { int32_t v; memcpy(&v, bytes, 4); *out = v; break; }
+        case PlyType::UINT32: { uint32_t v; memcpy(&v, bytes, 4); *out = v; break; }
+        case PlyType::FLOAT32: { float v; memcpy(&v, bytes, 4); *out = v; break; }
+        case PlyType::FLOAT64: { double v; memcpy(&v, bytes, 8); *out = v; break; }
+        default: return false;
+    }
+    return true;
+}
+
+// header words of one line
+static std::vector<std::string> split_words(const char* p, const char* line_end) {
+    std::vector<std::string> words;
+    while(p < line_end) {
+        p = skip_blank(p, line_end);
+        const char* word = p;
+        while(p < line_end && !is_blank(*p) && *p != '\n')
+            p++;
+        if(p > word)
+            words.push_back(std::string(word, p));
+        if(p < line_end && *p == '\n')
+            break;
+    }
+    return words;
+}
+
+static int property_index(const PlyElement& element, const char* name) {
+    for(size_t i = 0; i < element.properties.size(); i++)
+        if(element.properties[i].name == name && !element.properties[i].is_list)
+            return i;
+    return -1;
+}
+
+bool load_ply(const char* path, Mesh* out_mesh, LoadStats* out_stats) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if(!file.open(path))
+        return false;
+    const char* data = (const char*)file.get_data();
+    const char* end = data + file.get_size();
+
+    // ascii header up to end_header
+    const char* p = data;
+    bool big_endian = false;
+    bool header_done = false;
+    std::vector<PlyElement> elements;
+    for(int line = 0; p < end && !header_done; line++) {
+        const char* line_end = next_line(p, end);
+        std::vector<std::string> words = split_words(p, line_end);
+        p = line_end;
+        if(line == 0) {
+            if(words.size() != 1 || words[0] != "ply")
+                return false;
+        }
+        else if(words.empty() || words[0] == "comment" || words[0] == "obj_info")
+            continue;
+        else if(words[0] == "format") {
+            if(words.size() < 2 || (words[1] != "binary_little_endian" && words[1] != "binary_big_endian"))
+                return false;
+            big_endian = words[1] == "binary_big_endian";
+        }
+        else if(words[0] == "element" && words.size() == 3)
+            elements.push_back({words[1], (size_t)strtoull(words[2].c_str(), NULL, 10), {}});
+        else if(words[0] == "property" && !elements.empty()) {
+            if(words.size() == 5 && words[1] == "list")
+                elements.back().properties.push_back({words[4], ply_type(words[3]), true, ply_type(words[2])});
+            else if(words.size() == 3)
+                elements.back().properties.push_back({words[2], ply_type(words[1]), false, PlyType::INVALID});
+            else
+                return false;
+            const PlyProperty& property = elements.back().properties.back();
+            if(property.type == PlyType::INVALID || (property.is_list && property.count_type == PlyType::INVALID))
+                return false;
+        }
+        else if(words[0] == "end_header")
+            header_done = true;
+        else
+            return false;
+    }
+    if(!header_done)
+        return false;
+
+    uint16_t byte_order_test = 1;
+    bool swap_bytes = big_endian == (*(unsigned char*)&byte_order_test == 1);
+
+    Mesh mesh;
+    std::vector<Color> vertex_colors;
+    for(const PlyElement& element : elements) {
+        bool is_vertex = element.name == "vertex";
+        bool is_face = element.name == "face";
+        int x = property_index(element, "x"), y = property_index(element, "y"), z = property_index(element, "z");
+        int red = property_index(element, "red"), green = property_index(element, "green"), blue = property_index(element, "blue");
+        bool has_colors = red >= 0 && green >= 0 && blue >= 0;
+        // count comes from header, items that cannot fit in rest of file mean it is broken
+        size_t item_size = 0;
+        for(const PlyProperty& property : element.properties)
+            item_size += ply_type_size(property.is_list ? property.count_type : property.type);
+        if(element.count > 0 && (item_size == 0 || element.count > (size_t)(end - p) / item_size))
+            return false;
+        if(is_vertex) {
+            if(x < 0 || y < 0 || z < 0)
+                return false;
+            mesh.verticies.reserve(element.count);
+            if(has_colors)
+                vertex_colors.reserve(element.count);
+        }
+        // most models are triangles already
+        if(is_face)
+            mesh.triangles.reserve(mesh.triangles.size() + element.count);
+
+        std::vector<double> values(element.properties.size());
+        for(size_t item = 0; item < element.count; item++) {
+            for(size_t i = 0; i < element.properties.size(); i++) {
+                const PlyProperty& property = element.properties[i];
+                if(!property.is_list) {
+                    if(!ply_read(p, end, property.type, swap_bytes, &values[i]))
+                        return false;
+                    continue;
+                }
+
+                double count;
+                if(!ply_read(p, end, property.count_type, swap_bytes, &count) || count < 0)
+                    return false;
+                bool is_indices = is_face && (property.name == "vertex_indices" || property.name == "vertex_index");
+                if(!is_indices) {
+                    size_t skip = (size_t)count * ply_type_size(property.type);
+                    if((size_t)(end - p) < skip)
+                        return false;
+                    p += skip;
+                    continue;
+                }
+
+                // fan around first corner
+                uint32_t first = 0, previous = 0;
+                for(int corner = 0; corner < (int)count; corner++) {
+                    double index;
+                    if(!ply_read(p, end, property.type, swap_bytes, &index) || index < 0 || index >= mesh.verticies.size())
+                        return false;
+                    uint32_t vertex = index;
+                    if(corner == 0)
+                        first = vertex;
+                    else if(corner >= 2) {
+                        Color color = get_random_color();
+                        if(!vertex_colors.empty()) {
+                            const Color& c1 = vertex_colors[first];
+                            const Color& c2 = vertex_colors[previous];
+                            const Color& c3 = vertex_colors[vertex];
+                            color = (Color){
+                                (unsigned char)((c1.r + c2.r + c3.r) / 3),
+                                (unsigned char)((c1.g + c2.g + c3.g) / 3),
+                                (unsigned char)((c1.b + c2.b + c3.b) / 3),
+                                255
+                            };
+                        }
+                        mesh.add_triangle(first, previous, vertex, color);
+                    }
+                    previous = vertex;
+                }
+            }
+
+            if(is_vertex) {
+                mesh.add_vertex((Vector3){(float)values[x], (float)values[y], (float)values[z]});
+                if(has_colors)
+                    vertex_colors.push_back((Color){(unsigned char)values[red], (unsigned char)values[green], (unsigned char)values[blue], 255});
+            }
+        }
+    }
+
+    if(out_stats != NULL)
+        *out_stats = (LoadStats){file.get_size(), mesh.verticies.size(), mesh.triangles.size(), seconds_since(start)};
+    *out_mesh = std::move(mesh);
+    return true;
+}
+
+static bool has_extension(const char* path, const char* extension) {
+    const char* dot = strrchr(path, '.');
+    if(dot == NULL || strlen(dot) != strlen(extension))
+        return false;
+    for(size_t i = 0; dot[i] != '\0'; i++)
+        if(tolower((unsigned char)dot[i]) != extension[i])
+            return false;
+    return true;
+}
+
+// picks loader by file extension, .obj or .ply
+bool load_mesh(const char* path, Mesh* out_mesh, LoadStats* out_stats) {
+    if(has_extension(path, ".obj"))
+        return load_obj(path, out_mesh, out_stats);
+    if(has_extension(path, ".ply"))
+        return load_ply(path, out_mesh, out_stats);
+    return false;
+}
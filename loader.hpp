@@ -0,0 +1,25 @@
+#ifndef LOADER_HPP
+#define LOADER_HPP
+
+#include <cstddef>
+#include "mesh.hpp"
+
+struct LoadStats {
+    size_t bytes;
+    size_t vertex_count;
+    size_t triangle_count;
+    double load_time;
+};
+
+// wavefront obj, only v and f lines are used, polygons become triangle fans
+// file is mapped and parsed in place, mesh is sized by a counting pass first
+bool load_obj(const char* path, Mesh* out_mesh, LoadStats* out_stats = NULL);
+
+// binary little or big endian ply with vertex x, y, z and face vertex index lists
+// vertex red, green, blue give triangle colors
+bool load_ply(const char* path, Mesh* out_mesh, LoadStats* out_stats = NULL);
+
+// picks loader by file extension, .obj or .ply
+bool load_mesh(const char* path, Mesh* out_mesh, LoadStats* out_stats = NULL);
+
+#endif
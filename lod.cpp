@@ -0,0 +1,378 @@
+#include "include/raylib.h"
+#include "include/raymath.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "lod.hpp"
+
+// bounding sphere diameter on screen, in pixels, still drawn at full detail
+const float LOD_FULL_DETAIL_PIXELS = 256.0f;
+// levels with fewer triangles are not made
+const size_t LOD_MIN_TRIANGLES = 8;
+// level is dropped when simplification kept more than this part of the triangles
+const float LOD_MIN_REDUCTION = 0.75f;
+// planes holding open borders in place weigh this much more than triangle planes
+const double LOD_BORDER_WEIGHT = 1000.0;
+// optimal collapse point further than this many edge lengths from edge middle is not trusted
+const float LOD_MAX_TARGET_DISTANCE = 2.0f;
+
+// sum of squared distances to planes, symmetric 4x4 matrix stored as its upper half
+struct Quadric {
+    // aa ab ac ad bb bc bd cc cd dd
+    double q[10];
+
+    Quadric() {
+        memset(q, 0, sizeof(q));
+    }
+
+    void add_plane(double a, double b, double c, double d, double weight) {
+        double p[4] = {a, b, c, d};
+        int k = 0;
+        for(int i = 0; i < 4; i++)
+            for(int j = i; j < 4; j++)
+                q[k++] += weight * p[i] * p[j];
+    }
+
+    void add(const Quadric& other) {
+        for(int i = 0; i < 10; i++)
+            q[i] += other.q[i];
+    }
+
+    double error(Vector3 v) const {
+        double x = v.x, y = v.y, z = v.z;
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+            q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+            q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    // point of least error, false when planes do not pin down a point
+    bool minimum(Vector3* out) const {
+        double a[3][3] = {{q[0], q[1], q[2]}, {q[1], q[4], q[5]}, {q[2], q[5], q[7]}};
+        double b[3] = {-q[3], -q[6], -q[8]};
+        double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+            a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+            a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+        double scale = std::max(std::max(fabs(q[0]), fabs(q[4])), fabs(q[7]));
+        if(fabs(det) <= 1e-9 * scale * scale * scale)
+            return false;
+        // cramer's rule, column i replaced by b
+        double x[3];
+        for(int i = 0; i < 3; i++) {
+            double m[3][3];
+            memcpy(m, a, sizeof(m));
+            for(int r = 0; r < 3; r++)
+                m[r][i] = b[r];
+            x[i] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / det;
+        }
+        *out = (Vector3){(float)x[0], (float)x[1], (float)x[2]};
+        return true;
+    }
+};
+
+// edge a-b collapsed into target, valid while both verticies have the versions it was made with
+struct Collapse {
+    double cost;
+    uint32_t a, b;
+    uint32_t version_a, version_b;
+    Vector3 target;
+
+    bool operator<(const Collapse& other) const {
+        return cost > other.cost;
+    }
+};
+
+struct WeldKey {
+    uint32_t bits[3];
+
+    bool operator==(const WeldKey& other) const {
+        return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+    }
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey& key) const {
+        return ((size_t)key.bits[0] * 73856093u) ^ ((size_t)key.bits[1] * 19349663u) ^ ((size_t)key.bits[2] * 83492791u);
+    }
+};
+
+static uint64_t edge_key(uint32_t a, uint32_t b) {
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static Vector3 triangle_normal(Vector3 p0, Vector3 p1, Vector3 p2) {
+    return Vector3CrossProduct(Vector3Subtract(p1, p0), Vector3Subtract(p2, p0));
+}
+
+// edge collapse simplification with quadric error, cheapest collapse first until target_triangles are left
+// verticies at same position are welded first, so meshes with a vertex per triangle corner simplify too
+// open borders are kept in place, collapses that would flip a triangle are skipped
+Mesh simplify_mesh(const Mesh& mesh, size_t target_triangles) {
+    // weld, triangles left with a repeated vertex are dropped
+    std::vector<Vector3> positions;
+    std::vector<uint32_t> weld(mesh.verticies.size());
+    std::unordered_map<WeldKey, uint32_t, WeldKeyHash> welded;
+    for(size_t i = 0; i < mesh.verticies.size(); i++) {
+        WeldKey key;
+        memcpy(key.bits, &mesh.verticies[i], sizeof(key.bits));
+        auto found = welded.find(key);
+        if(found != welded.end()) {
+            weld[i] = found->second;
+            continue;
+        }
+        weld[i] = positions.size();
+        welded[key] = positions.size();
+        positions.push_back(mesh.verticies[i]);
+    }
+    std::vector<IndexedTriangle> triangles;
+    triangles.reserve(mesh.triangles.size());
+    for(const IndexedTriangle& t : mesh.triangles) {
+        IndexedTriangle w = t;
+        for(auto& v : w.v)
+            v = weld[v];
+        if(w.v[0] != w.v[1] && w.v[1] != w.v[2] && w.v[0] != w.v[2])
+            triangles.push_back(w);
+    }
+
+    // every vertex starts with planes of its triangles, weighted by area
+    std::vector<Quadric> quadrics(positions.size());
+    std::vector<std::vector<uint32_t>> vertex_triangles(positions.size());
+    std::unordered_map<uint64_t, uint32_t> edge_uses;
+    for(uint32_t t = 0; t < triangles.size(); t++) {
+        const uint32_t* v = triangles[t].v;
+        Vector3 normal = triangle_normal(positions[v[0]], positions[v[1]], positions[v[2]]);
+        float area = Vector3Length(normal);
+        for(int i = 0; i < 3; i++) {
+            vertex_triangles[v[i]].push_back(t);
+            edge_uses[edge_key(v[i], v[(i + 1) % 3])]++;
+        }
+        if(area == 0.0f)
+            continue;
+        normal = Vector3Scale(normal, 1.0f / area);
+        double d = -Vector3DotProduct(normal, positions[v[0]]);
+        for(int i = 0; i < 3; i++)
+            quadrics[v[i]].add_plane(normal.x, normal.y, normal.z, d, area * 0.5);
+    }
+
+    // edges of one triangle are borders, a plane through the edge along the triangle normal holds them
+    for(const IndexedTriangle& t : triangles) {
+        Vector3 normal = triangle_normal(positions[t.v[0]], positions[t.v[1]], positions[t.v[2]]);
+        if(Vector3Length(normal) == 0.0f)
+            continue;
+        for(int i = 0; i < 3; i++) {
+            uint32_t a = t.v[i], b = t.v[(i + 1) % 3];
+            if(edge_uses[edge_key(a, b)] != 1)
+                continue;
+            Vector3 edge = Vector3Subtract(positions[b], positions[a]);
+            Vector3 border = Vector3CrossProduct(edge, normal);
+            if(Vector3Length(border) == 0.0f)
+                continue;
+            border = Vector3Normalize(border);
+            double d = -Vector3DotProduct(border, positions[a]);
+            double weight = LOD_BORDER_WEIGHT * Vector3DotProduct(edge, edge);
+            quadrics[a].add_plane(border.x, border.y, border.z, d, weight);
+            quadrics[b].add_plane(border.x, border.y, border.z, d, weight);
+        }
+    }
+
+    std::vector<uint8_t> alive(triangles.size(), 1);
+    std::vector<uint8_t> removed(positions.size(), 0);
+    std::vector<uint32_t> version(positions.size(), 0);
+    std::priority_queue<Collapse> collapses;
+    auto push_collapse = [&](uint32_t a, uint32_t b) {
+        Quadric q = quadrics[a];
+        q.add(quadrics[b]);
+        Vector3 middle = Vector3Lerp(positions[a], positions[b], 0.5f);
+        float edge_length = Vector3Distance(positions[a], positions[b]);
+        Vector3 target;
+        bool found = q.minimum(&target) && Vector3Distance(target, middle) <= edge_length * LOD_MAX_TARGET_DISTANCE;
+        if(!found) {
+            // best of both ends and middle
+            target = middle;
+            for(Vector3 candidate : {positions[a], positions[b]})
+                if(q.error(candidate) < q.error(target))
+                    target = candidate;
+        }
+        collapses.push((Collapse){std::max(q.error(target), 0.0), a, b, version[a], version[b], target});
+    };
+    for(const auto& edge : edge_uses)
+        push_collapse(edge.first >> 32, (uint32_t)edge.first);
+
+    auto has_vertex = [&](uint32_t t, uint32_t v) {
+        return triangles[t].v[0] == v || triangles[t].v[1] == v || triangles[t].v[2] == v;
+    };
+    // triangles of v not on edge must keep facing the same way after v moves to target
+    auto flips = [&](uint32_t v, uint32_t other, Vector3 target) {
+        for(uint32_t t : vertex_triangles[v]) {
+            if(!alive[t] || has_vertex(t, other))
+                continue;
+            Vector3 p[3];
+            for(int i = 0; i < 3; i++)
+                p[i] = triangles[t].v[i] == v ? target : positions[triangles[t].v[i]];
+            Vector3 before = triangle_normal(positions[triangles[t].v[0]], positions[triangles[t].v[1]], positions[triangles[t].v[2]]);
+            Vector3 after = triangle_normal(p[0], p[1], p[2]);
+            if(Vector3DotProduct(before, after) <= 0.0f)
+                return true;
+        }
+        return false;
+    };
+    // live verticies sharing a triangle with v, sorted
+    auto neighbours = [&](uint32_t v) {
+        std::vector<uint32_t> around;
+        for(uint32_t t : vertex_triangles[v])
+            if(alive[t])
+                for(uint32_t u : triangles[t].v)
+                    if(u != v)
+                        around.push_back(u);
+        std::sort(around.begin(), around.end());
+        around.erase(std::unique(around.begin(), around.end()), around.end());
+        return around;
+    };
+
+    size_t live = triangles.size();
+    while(live > target_triangles && !collapses.empty()) {
+        Collapse c = collapses.top();
+        collapses.pop();
+        if(removed[c.a] || removed[c.b] || version[c.a] != c.version_a || version[c.b] != c.version_b)
+            continue;
+
+        // ends may only share the verticies opposite the edge, else collapse pinches mesh
+        int edge_triangles = 0;
+        for(uint32_t t : vertex_triangles[c.a])
+            edge_triangles += alive[t] && has_vertex(t, c.b);
+        std::vector<uint32_t> around_a = neighbours(c.a), around_b = neighbours(c.b);
+        std::vector<uint32_t> shared;
+        std::set_intersection(around_a.begin(), around_a.end(), around_b.begin(), around_b.end(), std::back_inserter(shared));
+        if(edge_triangles == 0 || (int)shared.size() != edge_triangles)
+            continue;
+        if(flips(c.a, c.b, c.target) || flips(c.b, c.a, c.target))
+            continue;
+
+        // b goes into a, triangles on the edge go away
+        for(uint32_t t : vertex_triangles[c.b]) {
+            if(!alive[t])
+                continue;
+            if(has_vertex(t, c.a)) {
+                alive[t] = 0;
+                live--;
+                continue;
+            }
+            for(auto& v : triangles[t].v)
+                if(v == c.b)
+                    v = c.a;
+            vertex_triangles[c.a].push_back(t);
+        }
+        vertex_triangles[c.b].clear();
+        removed[c.b] = 1;
+        positions[c.a] = c.target;
+        quadrics[c.a].add(quadrics[c.b]);
+        version[c.a]++;
+
+        auto& list = vertex_triangles[c.a];
+        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t) { return !alive[t]; }), list.end());
+        for(uint32_t u : neighbours(c.a))
+            push_collapse(c.a, u);
+    }
+
+    // only verticies of live triangles are kept
+    Mesh simplified;
+    std::vector<uint32_t> remap(positions.size(), UINT32_MAX);
+    simplified.triangles.reserve(live);
+    for(uint32_t t = 0; t < triangles.size(); t++) {
+        if(!alive[t])
+            continue;
+        IndexedTriangle out = triangles[t];
+        for(auto& v : out.v) {
+            if(remap[v] == UINT32_MAX)
+                remap[v] = simplified.add_vertex(positions[v]);
+            v = remap[v];
+        }
+        simplified.triangles.push_back(out);
+    }
+
+    return simplified;
+}
+
+LODMesh::LODMesh() {
+    this->center = (Vector3){0.0f, 0.0f, 0.0f};
+    this->radius = 0.0f;
+    this->build_time = 0.0;
+    levels.push_back(Mesh());
+}
+
+// levels stop early when simplification cannot halve triangles anymore
+LODMesh::LODMesh(const Mesh& mesh, int max_levels) {
+    auto start = std::chrono::steady_clock::now();
+    levels.push_back(mesh);
+
+    Vector3 bounds_min = (Vector3){0.0f, 0.0f, 0.0f}, bounds_max = (Vector3){0.0f, 0.0f, 0.0f};
+    for(size_t i = 0; i < mesh.verticies.size(); i++) {
+        bounds_min = i == 0 ? mesh.verticies[i] : Vector3Min(bounds_min, mesh.verticies[i]);
+        bounds_max = i == 0 ? mesh.verticies[i] : Vector3Max(bounds_max, mesh.verticies[i]);
+    }
+    this->center = Vector3Lerp(bounds_min, bounds_max, 0.5f);
+    this->radius = 0.0f;
+    for(const Vector3& v : mesh.verticies)
+        radius = std::max(radius, Vector3Distance(center, v));
+
+    // each level is simplified from the one before, cheaper than starting from full mesh every time
+    while((int)levels.size() < max_levels) {
+        size_t previous = levels.back().triangles.size();
+        if(previous / 2 < LOD_MIN_TRIANGLES)
+            break;
+        Mesh level = simplify_mesh(levels.back(), previous / 2);
+        if(level.triangles.size() > previous * LOD_MIN_REDUCTION)
+            break;
+        levels.push_back(level);
+    }
+    this->build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// level for mesh moved by offset, picked from screen height of its bounding sphere
+// every halving of sphere area on screen goes one level down
+int LODMesh::select_level(const Vcam& camera, Vector3 offset) const {
+    float distance = Vector3Distance(camera.get_pos(), Vector3Add(center, offset));
+    if(distance <= radius)
+        return 0;
+    // projection y scale is 1 / tan(fovy / 2), so zoom keeps detail
+    float focal = fabsf(camera.get_project_mat().m5);
+    float size = radius / sqrtf(distance * distance - radius * radius) * focal * screenHeight;
+    if(size >= LOD_FULL_DETAIL_PIXELS)
+        return 0;
+    int level = size > 0.0f ? (int)(2.0f * log2f(LOD_FULL_DETAIL_PIXELS / size)) : (int)levels.size();
+    return std::min(level, (int)levels.size() - 1);
+}
+
+const Mesh& LODMesh::get_level(int level) const {
+    return levels[level];
+}
+
+// copy of level moved by offset, for placing one model several times
+Mesh LODMesh::get_level(int level, Vector3 offset) const {
+    Mesh moved = levels[level];
+    for(auto& v : moved.verticies)
+        v = Vector3Add(v, offset);
+    return moved;
+}
+
+int LODMesh::level_count() const {
+    return levels.size();
+}
+
+float LODMesh::get_radius() const {
+    return radius;
+}
+
+Vector3 LODMesh::get_center() const {
+    return center;
+}
+
+double LODMesh::get_build_time() const {
+    return build_time;
+}
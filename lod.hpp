@@ -0,0 +1,51 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include "include/raylib.h"
+#include <cstddef>
+#include <vector>
+#include "util.hpp"
+#include "mesh.hpp"
+
+// edge collapse simplification with quadric error, cheapest collapse first until target_triangles are left
+// verticies at same position are welded first, so meshes with a vertex per triangle corner simplify too
+// open borders are kept in place, collapses that would flip a triangle are skipped
+Mesh simplify_mesh(const Mesh& mesh, size_t target_triangles);
+
+// mesh with simplified levels of detail, level 0 is mesh as given
+// every level has about half the triangles of the one before
+class LODMesh {
+private:
+    std::vector<Mesh> levels;
+    // bounding sphere of level 0
+    Vector3 center;
+    float radius;
+    double build_time;
+
+public:
+    // empty, for assigning later
+    LODMesh();
+
+    // levels stop early when simplification cannot halve triangles anymore
+    LODMesh(const Mesh& mesh, int max_levels = 6);
+
+    // level for mesh moved by offset, picked from screen height of its bounding sphere
+    // every halving of sphere area on screen goes one level down
+    int select_level(const Vcam& camera, Vector3 offset) const;
+
+    const Mesh& get_level(int level) const;
+
+    // copy of level moved by offset, for placing one model several times
+    Mesh get_level(int level, Vector3 offset) const;
+
+    int level_count() const;
+
+    float get_radius() const;
+
+    Vector3 get_center() const;
+
+    // time to simplify all levels
+    double get_build_time() const;
+};
+
+#endif
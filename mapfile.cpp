@@ -0,0 +1,104 @@
+#include "mapfile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+    this->data = nullptr;
+    this->size = 0;
+#ifdef _WIN32
+    this->file_handle = INVALID_HANDLE_VALUE;
+    this->mapping_handle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path) {
+    close();
+    file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file_handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if(mapping_handle == nullptr) {
+        close();
+        return false;
+    }
+    data = MapViewOfFile(mapping_handle, FILE_MAP_COPY, 0, 0, 0);
+    if(data == nullptr) {
+        close();
+        return false;
+    }
+    size = file_size.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if(data != nullptr)
+        UnmapViewOfFile(data);
+    if(mapping_handle != nullptr)
+        CloseHandle(mapping_handle);
+    if(file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(file_handle);
+    data = nullptr;
+    size = 0;
+    mapping_handle = nullptr;
+    file_handle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // mapping keeps the file alive
+    ::close(fd);
+    if(mapped == MAP_FAILED)
+        return false;
+
+    data = mapped;
+    size = file_stat.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if(data != nullptr)
+        munmap(data, size);
+    data = nullptr;
+    size = 0;
+}
+
+#endif
+
+void* MappedFile::get_data() const {
+    return data;
+}
+
+size_t MappedFile::get_size() const {
+    return size;
+}
@@ -0,0 +1,35 @@
+#ifndef MAPFILE_HPP
+#define MAPFILE_HPP
+
+#include <cstddef>
+
+// whole file mapped into memory, writes go to private copy on write pages
+// kept apart from raylib headers, windows.h clashes with them
+class MappedFile {
+private:
+    void* data;
+    size_t size;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#endif
+
+    void close();
+
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if file cannot be opened or is empty
+    bool open(const char* path);
+
+    void* get_data() const;
+
+    size_t get_size() const;
+};
+
+#endif
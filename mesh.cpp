@@ -0,0 +1,128 @@
+#include "include/raylib.h"
+#include "include/raymath.h"
+#include <cmath>
+#include "mesh.hpp"
+#include "util.hpp"
+
+uint32_t Mesh::add_vertex(Vector3 vertex) {
+    verticies.push_back(vertex);
+    return verticies.size() - 1;
+}
+
+uint32_t Mesh::add_triangle(uint32_t v1, uint32_t v2, uint32_t v3, Color color) {
+    triangles.push_back((IndexedTriangle){{v1, v2, v3}, color, true});
+    return triangles.size() - 1;
+}
+
+// triangle with its own three verticies
+uint32_t Mesh::add_triangle(const Triangle& triangle) {
+    uint32_t v1 = add_vertex(triangle.verticies[0]);
+    uint32_t v2 = add_vertex(triangle.verticies[1]);
+    uint32_t v3 = add_vertex(triangle.verticies[2]);
+    uint32_t t = add_triangle(v1, v2, v3, triangle.color);
+    triangles[t].visible = triangle.visible;
+    return t;
+}
+
+// copy other mesh in, its indices are moved past our verticies
+void Mesh::append(const Mesh& other) {
+    uint32_t offset = verticies.size();
+    verticies.insert(verticies.end(), other.verticies.begin(), other.verticies.end());
+    triangles.reserve(triangles.size() + other.triangles.size());
+    for(auto t : other.triangles) {
+        for(auto& v : t.v)
+            v += offset;
+        triangles.push_back(t);
+    }
+}
+
+// bytes of vertex and triangle arrays
+size_t Mesh::memory_usage() const {
+    return verticies.capacity() * sizeof(Vector3) + triangles.capacity() * sizeof(IndexedTriangle);
+}
+
+// plane through three points, same as Triangle::to_plane
+Vector4 points_to_plane(Vector3 p0, Vector3 p1, Vector3 p2) {
+    auto v1 = Vector3Subtract(p0, p1);
+    auto v2 = Vector3Subtract(p0, p2);
+    auto normal = Vector3CrossProduct(v1, v2);
+    auto d = -normal.x * p0.x - normal.y * p0.y - normal.z * p0.z;
+
+    return (Vector4){normal.x, normal.y, normal.z, d};
+}
+
+// plane scaled to unit normal, so plane equation gives distance
+Vector4 normalize_plane(Vector4 plane) {
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if(length == 0.0f)
+        return plane;
+
+    return (Vector4){plane.x / length, plane.y / length, plane.z / length, plane.w / length};
+}
+
+// same plane as Triangle::to_plane
+Vector4 Mesh::to_plane(uint32_t triangle) const {
+    return points_to_plane(vertex(triangle, 0), vertex(triangle, 1), vertex(triangle, 2));
+}
+
+TriangleStore::TriangleStore() {}
+
+TriangleStore::TriangleStore(const Mesh& mesh) {
+    size_t vertex_count = mesh.verticies.size();
+    x.resize(vertex_count);
+    y.resize(vertex_count);
+    z.resize(vertex_count);
+    for(size_t i = 0; i < vertex_count; i++) {
+        x[i] = mesh.verticies[i].x;
+        y[i] = mesh.verticies[i].y;
+        z[i] = mesh.verticies[i].z;
+    }
+    indices.reserve(mesh.triangles.size() * 3);
+    planes.reserve(mesh.triangles.size());
+    colors.reserve(mesh.triangles.size());
+    flags.reserve(mesh.triangles.size());
+    for(const IndexedTriangle& t : mesh.triangles)
+        add_triangle(t.v[0], t.v[1], t.v[2], t.color, t.visible);
+}
+
+uint32_t TriangleStore::add_vertex(Vector3 vertex) {
+    x.push_back(vertex.x);
+    y.push_back(vertex.y);
+    z.push_back(vertex.z);
+    return x.size() - 1;
+}
+
+// plane is computed from the verticies
+uint32_t TriangleStore::add_triangle(uint32_t v1, uint32_t v2, uint32_t v3, Color color, bool visible) {
+    indices.push_back(v1);
+    indices.push_back(v2);
+    indices.push_back(v3);
+    planes.push_back(points_to_plane(vertex(v1), vertex(v2), vertex(v3)));
+    colors.push_back(color);
+    flags.push_back(visible ? TRIANGLE_VISIBLE : 0);
+    return colors.size() - 1;
+}
+
+void TriangleStore::set_visible(uint32_t triangle, bool visible) {
+    flags[triangle] = visible ? flags[triangle] | TRIANGLE_VISIBLE : flags[triangle] & ~TRIANGLE_VISIBLE;
+}
+
+void TriangleStore::recompute_planes() {
+    for(size_t t = 0; t < triangle_count(); t++) {
+        const uint32_t* v = &indices[3 * t];
+        planes[t] = points_to_plane(vertex(v[0]), vertex(v[1]), vertex(v[2]));
+    }
+}
+
+Mesh TriangleStore::to_mesh() const {
+    Mesh mesh;
+    mesh.verticies.reserve(vertex_count());
+    for(uint32_t v = 0; v < vertex_count(); v++)
+        mesh.add_vertex(vertex(v));
+    mesh.triangles.reserve(triangle_count());
+    for(uint32_t t = 0; t < triangle_count(); t++) {
+        uint32_t i = mesh.add_triangle(indices[3 * t], indices[3 * t + 1], indices[3 * t + 2], colors[t]);
+        mesh.triangles[i].visible = is_visible(t);
+    }
+    return mesh;
+}
@@ -0,0 +1,125 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include "include/raylib.h"
+#include <cstdint>
+#include <vector>
+
+class Triangle;
+
+// triangle as three indices into shared verticies
+struct IndexedTriangle {
+    uint32_t v[3];
+    Color color;
+    bool visible;
+};
+
+// plane through three points, same as Triangle::to_plane
+Vector4 points_to_plane(Vector3 p0, Vector3 p1, Vector3 p2);
+
+// plane scaled to unit normal, so plane equation gives distance
+// planes of degenerate triangles have no normal and are returned as they are
+Vector4 normalize_plane(Vector4 plane);
+
+// which side of plane are the points on, points within thickness of plane count as on it
+// 1 if in front, 0 if they cross, -1 if behind
+inline int points_plane_side(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector4& plane, float thickness = 0.0f) {
+    const Vector3* points[3] = {&p0, &p1, &p2};
+    bool front = true, behind = true;
+    for(int i = 0; i < 3; i++) {
+        const Vector3& p = *points[i];
+        float sign = plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+        front = front && sign >= -thickness;
+        behind = behind && sign <= thickness;
+    }
+    if(front)
+        return 1;
+    else if(behind)
+        return -1;
+
+    return 0;
+}
+
+// shared vertex buffer with index buffer, one entry per triangle
+class Mesh {
+public:
+    std::vector<Vector3> verticies;
+    std::vector<IndexedTriangle> triangles;
+
+    uint32_t add_vertex(Vector3 vertex);
+
+    uint32_t add_triangle(uint32_t v1, uint32_t v2, uint32_t v3, Color color);
+
+    // triangle with its own three verticies
+    uint32_t add_triangle(const Triangle& triangle);
+
+    // copy other mesh in, its indices are moved past our verticies
+    void append(const Mesh& other);
+
+    // bytes of vertex and triangle arrays
+    size_t memory_usage() const;
+
+    // hot in bsp build, kept inline
+    Vector3 vertex(uint32_t triangle, int i) const {
+        return verticies[triangles[triangle].v[i]];
+    }
+
+    // same plane as Triangle::to_plane
+    Vector4 to_plane(uint32_t triangle) const;
+
+    // which side of plane is triangle on
+    // 1 if in front, 0 if it crosses, -1 if behind
+    int plane_side(uint32_t triangle, const Vector4& plane, float thickness = 0.0f) const {
+        const uint32_t* v = triangles[triangle].v;
+        return points_plane_side(verticies[v[0]], verticies[v[1]], verticies[v[2]], plane, thickness);
+    }
+};
+
+// triangle flags
+const uint8_t TRIANGLE_VISIBLE = 1;
+
+// triangles as structure of arrays, passes over many triangles load only the fields they use
+// vertex coordinates are split, so they go to transform_verticies as they are
+// planes are computed once, call recompute_planes after moving verticies
+class TriangleStore {
+public:
+    std::vector<float> x, y, z;
+    // three vertex indices per triangle
+    std::vector<uint32_t> indices;
+    std::vector<Vector4> planes;
+    std::vector<Color> colors;
+    std::vector<uint8_t> flags;
+
+    TriangleStore();
+
+    TriangleStore(const Mesh& mesh);
+
+    size_t vertex_count() const {
+        return x.size();
+    }
+
+    size_t triangle_count() const {
+        return colors.size();
+    }
+
+    Vector3 vertex(uint32_t v) const {
+        return (Vector3){x[v], y[v], z[v]};
+    }
+
+    uint32_t add_vertex(Vector3 vertex);
+
+    // plane is computed from the verticies
+    uint32_t add_triangle(uint32_t v1, uint32_t v2, uint32_t v3, Color color, bool visible = true);
+
+    bool is_visible(uint32_t triangle) const {
+        return flags[triangle] & TRIANGLE_VISIBLE;
+    }
+
+    void set_visible(uint32_t triangle, bool visible);
+
+    void recompute_planes();
+
+    Mesh to_mesh() const;
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "include/raylib.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "render.hpp"
+
+// subpixel precision of software rasterizer, 1/16 pixel
+const int SUBPIXEL_BITS = 4;
+const int64_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// coverage block side, 8 pixels
+const int COVERAGE_BLOCK_BITS = 3;
+const int COVERAGE_BLOCK = 1 << COVERAGE_BLOCK_BITS;
+
+void WindowTarget::clear(Color color) {
+    ClearBackground(color);
+}
+
+void WindowTarget::draw(const TriangleBatch& batch) {
+    batch.submit();
+}
+
+SoftwareTarget::SoftwareTarget(int width, int height) {
+    this->width = width;
+    this->height = height;
+    this->pixels.resize((size_t)width * height);
+    this->front_to_back = false;
+    this->depth_test = false;
+    this->blocks_x = (width + COVERAGE_BLOCK - 1) / COVERAGE_BLOCK;
+}
+
+// clears pixels, coverage and depth of rows from first to last, last excluded
+void SoftwareTarget::clear_rows(Color color, int first_row, int last_row) {
+    std::fill(pixels.begin() + (size_t)first_row * width, pixels.begin() + (size_t)last_row * width, color);
+    if(!depth.empty())
+        std::fill(depth.begin() + (size_t)first_row * width, depth.begin() + (size_t)last_row * width, INFINITY);
+    if(covered.empty())
+        return;
+
+    std::fill(covered.begin() + (size_t)first_row * width, covered.begin() + (size_t)last_row * width, 0);
+    int first_block = first_row / COVERAGE_BLOCK;
+    int last_block = (last_row + COVERAGE_BLOCK - 1) / COVERAGE_BLOCK;
+    std::fill(block_covered.begin() + (size_t)first_block * blocks_x, block_covered.begin() + (size_t)last_block * blocks_x, 0);
+}
+
+void SoftwareTarget::clear(Color color) {
+    clear_rows(color, 0, height);
+}
+
+bool SoftwareTarget::supports_front_to_back() const {
+    return true;
+}
+
+// coverage is kept until next clear
+void SoftwareTarget::set_front_to_back(bool enabled) {
+    if(enabled && covered.empty()) {
+        int blocks_y = (height + COVERAGE_BLOCK - 1) / COVERAGE_BLOCK;
+        covered.assign((size_t)width * height, 0);
+        block_covered.assign((size_t)blocks_x * blocks_y, 0);
+    }
+    front_to_back = enabled;
+}
+
+bool SoftwareTarget::supports_depth_test() const {
+    return true;
+}
+
+// depth is kept until next clear
+void SoftwareTarget::set_depth_test(bool enabled) {
+    if(enabled && depth.empty())
+        depth.assign((size_t)width * height, INFINITY);
+    depth_test = enabled;
+}
+
+size_t SoftwareTarget::memory_usage() const {
+    return pixels.capacity() * sizeof(Color) + covered.capacity() + block_covered.capacity() * sizeof(uint16_t) +
+        depth.capacity() * sizeof(float);
+}
+
+// checks whole 8x8 blocks, so may say no for covered rectangles near edges of drawn area
+bool SoftwareTarget::is_covered(int min_x, int min_y, int max_x, int max_y) const {
+    if(!front_to_back)
+        return false;
+    min_x = std::max(min_x, 0);
+    min_y = std::max(min_y, 0);
+    max_x = std::min(max_x, width - 1);
+    max_y = std::min(max_y, height - 1);
+    // nothing of rectangle is on screen
+    if(min_x > max_x || min_y > max_y)
+        return true;
+
+    for(int by = min_y >> COVERAGE_BLOCK_BITS; by <= max_y >> COVERAGE_BLOCK_BITS; by++) {
+        int block_height = std::min(COVERAGE_BLOCK, height - by * COVERAGE_BLOCK);
+        for(int bx = min_x >> COVERAGE_BLOCK_BITS; bx <= max_x >> COVERAGE_BLOCK_BITS; bx++) {
+            int block_width = std::min(COVERAGE_BLOCK, width - bx * COVERAGE_BLOCK);
+            if(block_covered[by * blocks_x + bx] != block_width * block_height)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void SoftwareTarget::draw(const TriangleBatch& batch) {
+    const std::vector<Vector2>& verticies = batch.get_verticies();
+    const std::vector<Color>& colors = batch.get_colors();
+    const std::vector<float>& depths = batch.get_depths();
+    for(size_t i = 0; i < colors.size(); i++) {
+        RasterTriangle triangle;
+        if(setup_triangle(verticies[3*i], verticies[3*i + 1], verticies[3*i + 2], colors[i], depths.empty() ? NULL : &depths[3*i], &triangle))
+            fill_triangle(triangle, 0, 0, width - 1, height - 1);
+    }
+}
+
+static Color blend(Color dst, Color src) {
+    if(src.a == 255)
+        return src;
+    int a = src.a;
+    return (Color){
+        (unsigned char)((src.r * a + dst.r * (255 - a)) / 255),
+        (unsigned char)((src.g * a + dst.g * (255 - a)) / 255),
+        (unsigned char)((src.b * a + dst.b * (255 - a)) / 255),
+        (unsigned char)std::max((int)dst.a, a)
+    };
+}
+
+// top and left edges own pixel centers lying exactly on them
+static bool is_top_left(int64_t dx, int64_t dy) {
+    return dy < 0 || (dy == 0 && dx > 0);
+}
+
+// false if triangle covers no pixel of target
+// z holds ndc z of the three verticies, or NULL for flat 0
+bool SoftwareTarget::setup_triangle(Vector2 v1, Vector2 v2, Vector2 v3, Color color, const float* z, RasterTriangle* out) const {
+    if(!std::isfinite(v1.x + v1.y + v2.x + v2.y + v3.x + v3.y))
+        return false;
+
+    // snap to subpixel grid so edges shared by two triangles give exact same tests
+    int64_t* x = out->x;
+    int64_t* y = out->y;
+    x[0] = llroundf(v1.x * SUBPIXEL_ONE); x[1] = llroundf(v2.x * SUBPIXEL_ONE); x[2] = llroundf(v3.x * SUBPIXEL_ONE);
+    y[0] = llroundf(v1.y * SUBPIXEL_ONE); y[1] = llroundf(v2.y * SUBPIXEL_ONE); y[2] = llroundf(v3.y * SUBPIXEL_ONE);
+
+    int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if(area == 0)
+        return false;
+    // edge functions are positive inside
+    bool swapped = area < 0;
+    if(swapped) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        area = -area;
+    }
+
+    // ndc z is linear in screen space, plane through snapped verticies
+    out->z = 0.0f;
+    out->dzdx = 0.0f;
+    out->dzdy = 0.0f;
+    if(z != NULL) {
+        double z0 = z[0];
+        double z1 = swapped ? z[2] : z[1];
+        double z2 = swapped ? z[1] : z[2];
+        double gradient_x = ((z1 - z0) * (y[2] - y[0]) - (z2 - z0) * (y[1] - y[0])) / area;
+        double gradient_y = ((z2 - z0) * (x[1] - x[0]) - (z1 - z0) * (x[2] - x[0])) / area;
+        out->z = z0 + gradient_x * (SUBPIXEL_ONE / 2 - x[0]) + gradient_y * (SUBPIXEL_ONE / 2 - y[0]);
+        out->dzdx = gradient_x * SUBPIXEL_ONE;
+        out->dzdy = gradient_y * SUBPIXEL_ONE;
+    }
+
+    out->min_x = std::max<int64_t>(0, std::min({x[0], x[1], x[2]}) >> SUBPIXEL_BITS);
+    out->min_y = std::max<int64_t>(0, std::min({y[0], y[1], y[2]}) >> SUBPIXEL_BITS);
+    out->max_x = std::min<int64_t>(width - 1, std::max({x[0], x[1], x[2]}) >> SUBPIXEL_BITS);
+    out->max_y = std::min<int64_t>(height - 1, std::max({y[0], y[1], y[2]}) >> SUBPIXEL_BITS);
+    out->color = color;
+    return out->min_x <= out->max_x && out->min_y <= out->max_y;
+}
+
+// fills pixels of triangle inside given pixel rectangle
+void SoftwareTarget::fill_triangle(const RasterTriangle& triangle, int min_x, int min_y, int max_x, int max_y) {
+    min_x = std::max(min_x, triangle.min_x);
+    min_y = std::max(min_y, triangle.min_y);
+    max_x = std::min(max_x, triangle.max_x);
+    max_y = std::min(max_y, triangle.max_y);
+    if(min_x > max_x || min_y > max_y)
+        return;
+    if(front_to_back && !depth_test && is_covered(min_x, min_y, max_x, max_y))
+        return;
+
+    // edge i goes from vertex i to vertex i+1, stepped per pixel
+    const int64_t* x = triangle.x;
+    const int64_t* y = triangle.y;
+    int64_t step_x[3], step_y[3], row[3], bias[3];
+    int64_t start_x = (int64_t)min_x * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+    int64_t start_y = (int64_t)min_y * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+    for(int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        int64_t dx = x[j] - x[i];
+        int64_t dy = y[j] - y[i];
+        step_x[i] = -dy * SUBPIXEL_ONE;
+        step_y[i] = dx * SUBPIXEL_ONE;
+        row[i] = dx * (start_y - y[i]) - dy * (start_x - x[i]);
+        bias[i] = is_top_left(dx, dy) ? 0 : -1;
+    }
+
+    Color color = triangle.color;
+    for(int py = min_y; py <= max_y; py++) {
+        int64_t w[3] = {row[0], row[1], row[2]};
+        Color* line = &pixels[(size_t)py * width];
+        if(depth_test) {
+            // any order, nearest pixel wins
+            // z is evaluated per pixel, not stepped, so tiles agree with whole screen draws
+            float* depth_line = &depth[(size_t)py * width];
+            float row_z = triangle.z + triangle.dzdy * py;
+            for(int px = min_x; px <= max_x; px++) {
+                float z = row_z + triangle.dzdx * px;
+                if(w[0] + bias[0] >= 0 && w[1] + bias[1] >= 0 && w[2] + bias[2] >= 0 && z < depth_line[px]) {
+                    depth_line[px] = z;
+                    line[px] = blend(line[px], color);
+                }
+                for(int i = 0; i < 3; i++)
+                    w[i] += step_x[i];
+            }
+        }
+        else if(front_to_back) {
+            // nearer triangles came first, only uncovered pixels are drawn
+            uint8_t* covered_line = &covered[(size_t)py * width];
+            uint16_t* block_line = &block_covered[(size_t)(py >> COVERAGE_BLOCK_BITS) * blocks_x];
+            for(int px = min_x; px <= max_x; px++) {
+                if(!covered_line[px] && w[0] + bias[0] >= 0 && w[1] + bias[1] >= 0 && w[2] + bias[2] >= 0) {
+                    line[px] = color;
+                    covered_line[px] = 1;
+                    block_line[px >> COVERAGE_BLOCK_BITS]++;
+                }
+                for(int i = 0; i < 3; i++)
+                    w[i] += step_x[i];
+            }
+        }
+        else {
+            for(int px = min_x; px <= max_x; px++) {
+                if(w[0] + bias[0] >= 0 && w[1] + bias[1] >= 0 && w[2] + bias[2] >= 0)
+                    line[px] = blend(line[px], color);
+                for(int i = 0; i < 3; i++)
+                    w[i] += step_x[i];
+            }
+        }
+        for(int i = 0; i < 3; i++)
+            row[i] += step_y[i];
+    }
+}
+
+void SoftwareTarget::draw_triangle(Vector2 v1, Vector2 v2, Vector2 v3, Color color) {
+    RasterTriangle triangle;
+    if(setup_triangle(v1, v2, v3, color, NULL, &triangle))
+        fill_triangle(triangle, 0, 0, width - 1, height - 1);
+}
+
+// binary ppm, alpha is dropped
+bool SoftwareTarget::save_ppm(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> rgb((size_t)width * height * 3);
+    for(size_t i = 0; i < pixels.size(); i++) {
+        rgb[3*i] = pixels[i].r;
+        rgb[3*i + 1] = pixels[i].g;
+        rgb[3*i + 2] = pixels[i].b;
+    }
+    bool ok = fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    return fclose(file) == 0 && ok;
+}
+
+TiledTarget::TiledTarget(int width, int height, int thread_count, int tile_size)
+    : SoftwareTarget(width, height), pool(thread_count) {
+    // tiles must not share coverage blocks
+    this->tile_size = (tile_size + COVERAGE_BLOCK - 1) / COVERAGE_BLOCK * COVERAGE_BLOCK;
+    this->tiles_x = (width + this->tile_size - 1) / this->tile_size;
+    this->tiles_y = (height + this->tile_size - 1) / this->tile_size;
+    this->bins.resize(tiles_x * tiles_y);
+}
+
+void TiledTarget::clear(Color color) {
+    pool.parallel_for(tiles_y, [&](size_t tile_y) {
+        clear_rows(color, tile_y * tile_size, std::min((int)(tile_y + 1) * tile_size, height));
+    });
+}
+
+void TiledTarget::draw(const TriangleBatch& batch) {
+    const std::vector<Vector2>& verticies = batch.get_verticies();
+    const std::vector<Color>& colors = batch.get_colors();
+    const std::vector<float>& depths = batch.get_depths();
+
+    // bin triangles by bounding box, keeps batch order inside every tile
+    raster_triangles.resize(colors.size());
+    for(auto& bin : bins)
+        bin.clear();
+    uint32_t count = 0;
+    for(size_t i = 0; i < colors.size(); i++) {
+        RasterTriangle& triangle = raster_triangles[count];
+        if(!setup_triangle(verticies[3*i], verticies[3*i + 1], verticies[3*i + 2], colors[i], depths.empty() ? NULL : &depths[3*i], &triangle))
+            continue;
+        for(int ty = triangle.min_y / tile_size; ty <= triangle.max_y / tile_size; ty++)
+            for(int tx = triangle.min_x / tile_size; tx <= triangle.max_x / tile_size; tx++)
+                bins[ty * tiles_x + tx].push_back(count);
+        count++;
+    }
+
+    // tiles own disjoint pixels, no locking needed
+    pool.parallel_for(bins.size(), [&](size_t tile) {
+        int min_x = (tile % tiles_x) * tile_size;
+        int min_y = (tile / tiles_x) * tile_size;
+        int max_x = std::min(min_x + tile_size, width) - 1;
+        int max_y = std::min(min_y + tile_size, height) - 1;
+        for(uint32_t t : bins[tile])
+            fill_triangle(raster_triangles[t], min_x, min_y, max_x, max_y);
+    });
+}
+
+int TiledTarget::thread_count() const {
+    return pool.size();
+}
@@ -0,0 +1,137 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include "include/raylib.h"
+#include <cstdint>
+#include <vector>
+#include "batch.hpp"
+#include "threads.hpp"
+
+// where batches of screen space triangles end up
+class RenderTarget {
+public:
+    virtual ~RenderTarget() = default;
+
+    virtual void clear(Color color) = 0;
+
+    virtual void draw(const TriangleBatch& batch) = 0;
+
+    // targets that keep a coverage buffer can draw nearest triangles first
+    virtual bool supports_front_to_back() const { return false; }
+
+    // while enabled drawn pixels are never drawn over again
+    virtual void set_front_to_back(bool enabled) {}
+
+    // front to back only, true if every pixel of rectangle is already drawn
+    virtual bool is_covered(int min_x, int min_y, int max_x, int max_y) const { return false; }
+
+    // targets with a depth buffer can draw batches with depth in any order
+    virtual bool supports_depth_test() const { return false; }
+
+    // while enabled pixels are drawn only if nearer than what is there
+    virtual void set_depth_test(bool enabled) {}
+
+    // bytes of framebuffer and helper buffers
+    virtual size_t memory_usage() const { return 0; }
+};
+
+// raylib window, use between BeginDrawing and EndDrawing
+class WindowTarget : public RenderTarget {
+public:
+    void clear(Color color) override;
+
+    void draw(const TriangleBatch& batch) override;
+};
+
+// triangle snapped to subpixel grid, ready for filling
+struct RasterTriangle {
+    // edge functions are positive inside
+    int64_t x[3];
+    int64_t y[3];
+    // pixel bounds clamped to target
+    int min_x, min_y, max_x, max_y;
+    Color color;
+    // ndc z at center of pixel 0, 0 and its change per pixel
+    float z;
+    float dzdx;
+    float dzdy;
+};
+
+// cpu rasterizer into rgba framebuffer, needs no window or gpu
+class SoftwareTarget : public RenderTarget {
+protected:
+    bool front_to_back;
+    // front to back coverage, one flag per pixel
+    std::vector<uint8_t> covered;
+    // drawn pixels per 8x8 block, for quick rectangle tests
+    int blocks_x;
+    std::vector<uint16_t> block_covered;
+    bool depth_test;
+    // ndc z per pixel, allocated with first depth test
+    std::vector<float> depth;
+
+    // clears pixels, coverage and depth of rows from first to last, last excluded
+    void clear_rows(Color color, int first_row, int last_row);
+
+    // false if triangle covers no pixel of target
+    // z holds ndc z of the three verticies, or NULL for flat 0
+    bool setup_triangle(Vector2 v1, Vector2 v2, Vector2 v3, Color color, const float* z, RasterTriangle* out) const;
+
+    // fills pixels of triangle inside given pixel rectangle
+    void fill_triangle(const RasterTriangle& triangle, int min_x, int min_y, int max_x, int max_y);
+
+public:
+    int width;
+    int height;
+    // row major, top row first
+    std::vector<Color> pixels;
+
+    SoftwareTarget(int width, int height);
+
+    void clear(Color color) override;
+
+    void draw(const TriangleBatch& batch) override;
+
+    bool supports_front_to_back() const override;
+
+    void set_front_to_back(bool enabled) override;
+
+    bool is_covered(int min_x, int min_y, int max_x, int max_y) const override;
+
+    bool supports_depth_test() const override;
+
+    void set_depth_test(bool enabled) override;
+
+    size_t memory_usage() const override;
+
+    // pixel centers inside triangle, shared edges are filled once
+    void draw_triangle(Vector2 v1, Vector2 v2, Vector2 v3, Color color);
+
+    // binary ppm, alpha is dropped
+    bool save_ppm(const char* path) const;
+};
+
+// software target split into tiles, tiles are filled in parallel
+// each tile draws its triangles in batch order, so painter's order holds
+class TiledTarget : public SoftwareTarget {
+private:
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    std::vector<RasterTriangle> raster_triangles;
+    // triangles overlapping each tile, in batch order
+    std::vector<std::vector<uint32_t>> bins;
+    ThreadPool pool;
+
+public:
+    // 0 threads uses every hardware thread
+    TiledTarget(int width, int height, int thread_count = 0, int tile_size = 64);
+
+    void clear(Color color) override;
+
+    void draw(const TriangleBatch& batch) override;
+
+    int thread_count() const;
+};
+
+#endif
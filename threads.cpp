@@ -0,0 +1,158 @@
+#include <algorithm>
+#include "threads.hpp"
+
+// yields in wait before it sleeps, short tasks of other threads finish without a wakeup
+const int WAIT_SPIN_COUNT = 64;
+
+// pool and queue of the worker running on this thread
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local int current_index = 0;
+
+TaskGroup::TaskGroup() {
+    this->pending = 0;
+}
+
+ThreadPool::ThreadPool(int thread_count) {
+    if(thread_count <= 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    this->queued = 0;
+    this->stopping = false;
+    for(int i = 0; i < thread_count; i++)
+        queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+    for(int i = 1; i < thread_count; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::worker_loop(int index) {
+    current_pool = this;
+    current_index = index;
+    while(true) {
+        Task task;
+        if(find_task(index, &task)) {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || queued > 0; });
+        if(stopping)
+            return;
+    }
+}
+
+// own queue from the back, other queues from the front
+bool ThreadPool::find_task(int index, Task* out) {
+    if(queued == 0)
+        return false;
+
+    int count = queues.size();
+    for(int k = 0; k < count; k++) {
+        TaskQueue& queue = *queues[(index + k) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.tasks.empty())
+            continue;
+        if(k == 0) {
+            *out = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else {
+            *out = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::run_task(Task& task) {
+    task.function();
+    if(--task.group->pending == 0) {
+        // pairs with wait, no wakeup gets lost
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_all();
+    }
+}
+
+// task may spawn more tasks and wait for them
+void ThreadPool::spawn(TaskGroup& group, std::function<void()> task) {
+    group.pending++;
+    if(workers.empty()) {
+        task();
+        group.pending--;
+        return;
+    }
+
+    TaskQueue& queue = *queues[thread_index()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back({std::move(task), &group});
+    }
+    {
+        // pairs with wait in worker_loop, no wakeup gets lost
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+    wake.notify_one();
+    finished.notify_all();
+}
+
+// runs queued tasks until every task of group is done
+void ThreadPool::wait(TaskGroup& group) {
+    int index = thread_index();
+    int spins = 0;
+    while(group.pending > 0) {
+        Task task;
+        if(find_task(index, &task)) {
+            run_task(task);
+            spins = 0;
+        }
+        else if(spins < WAIT_SPIN_COUNT) {
+            std::this_thread::yield();
+            spins++;
+        }
+        else {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return group.pending == 0 || queued > 0; });
+            spins = 0;
+        }
+    }
+}
+
+// calls job(i) for every i below count, returns when all are done
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& job) {
+    std::atomic<size_t> next_index(0);
+    auto run_jobs = [&]() {
+        size_t i;
+        while((i = next_index++) < count)
+            job(i);
+    };
+
+    TaskGroup group;
+    size_t helpers = std::min(count, (size_t)size()) - (count > 0 ? 1 : 0);
+    for(size_t i = 0; i < helpers; i++)
+        spawn(group, run_jobs);
+    run_jobs();
+    wait(group);
+}
+
+int ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+// 1 to size() - 1 for pool workers, 0 for any other thread
+int ThreadPool::thread_index() const {
+    return current_pool == this ? current_index : 0;
+}
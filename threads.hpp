@@ -0,0 +1,78 @@
+#ifndef THREADS_HPP
+#define THREADS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// tasks spawned together, wait returns when all of them finished
+class TaskGroup {
+public:
+    std::atomic<int> pending;
+
+    TaskGroup();
+};
+
+// work stealing pool, threads take own newest task first and steal oldest tasks of others
+// calling thread works too while it waits
+class ThreadPool {
+private:
+    struct Task {
+        std::function<void()> function;
+        TaskGroup* group;
+    };
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    // queue 0 belongs to threads outside of pool
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::atomic<int> queued;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // threads blocked in wait, woken when a group finishes or a task is queued
+    std::condition_variable finished;
+    bool stopping;
+
+    void worker_loop(int index);
+
+    bool find_task(int index, Task* out);
+
+    void run_task(Task& task);
+
+public:
+    // 0 uses every hardware thread
+    ThreadPool(int thread_count = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // task may spawn more tasks and wait for them
+    void spawn(TaskGroup& group, std::function<void()> task);
+
+    // runs queued tasks until every task of group is done
+    // spins a little when nothing is left to steal, then sleeps until group finishes or a task is queued
+    void wait(TaskGroup& group);
+
+    // calls job(i) for every i below count, returns when all are done
+    void parallel_for(size_t count, const std::function<void(size_t)>& job);
+
+    // threads working on tasks, including the calling one
+    int size() const;
+
+    // 1 to size() - 1 for pool workers, 0 for any other thread
+    int thread_index() const;
+};
+
+#endif
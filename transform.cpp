@@ -0,0 +1,248 @@
+#include "include/raylib.h"
+#include <cstring>
+#include "transform.hpp"
+#include "util.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+void VertexBuffer::resize(size_t count) {
+    for(auto* v : {&x, &y, &z, &clip_x, &clip_y, &clip_z, &clip_w, &screen_x, &screen_y})
+        v->resize(count);
+}
+
+// transformed arrays only, for input that lives elsewhere
+void VertexBuffer::resize_output(size_t count) {
+    for(auto* v : {&clip_x, &clip_y, &clip_z, &clip_w, &screen_x, &screen_y})
+        v->resize(count);
+}
+
+VertexArrays VertexBuffer::input() const {
+    return (VertexArrays){x.data(), y.data(), z.data(), x.size()};
+}
+
+TransformedArrays VertexBuffer::output() {
+    return (TransformedArrays){
+        clip_x.data(), clip_y.data(), clip_z.data(), clip_w.data(), screen_x.data(), screen_y.data()
+    };
+}
+
+// is vertex i between near and far planes
+bool VertexBuffer::in_depth_range(size_t i) const {
+    return clip_z[i] >= -clip_w[i] && clip_z[i] <= clip_w[i];
+}
+
+Vector4 VertexBuffer::clip(size_t i) const {
+    return (Vector4){clip_x[i], clip_y[i], clip_z[i], clip_w[i]};
+}
+
+Vector2 VertexBuffer::screen(size_t i) const {
+    return (Vector2){screen_x[i], screen_y[i]};
+}
+
+float VertexBuffer::depth(size_t i) const {
+    return clip_z[i] / clip_w[i];
+}
+
+// bytes of input and transformed arrays
+size_t VertexBuffer::memory_usage() const {
+    size_t bytes = 0;
+    for(auto* v : {&x, &y, &z, &clip_x, &clip_y, &clip_z, &clip_w, &screen_x, &screen_y})
+        bytes += v->capacity() * sizeof(float);
+    return bytes;
+}
+
+static void transform_scalar(const Matrix& m, const VertexArrays& in, const TransformedArrays& out, size_t first) {
+    const float half_width = screenWidth/2.0f;
+    const float half_height = screenHeight/2.0f;
+    for(size_t i = first; i < in.count; i++) {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+        float cx = m.m0*x + m.m4*y + m.m8*z + m.m12;
+        float cy = m.m1*x + m.m5*y + m.m9*z + m.m13;
+        float cz = m.m2*x + m.m6*y + m.m10*z + m.m14;
+        float cw = m.m3*x + m.m7*y + m.m11*z + m.m15;
+        out.clip_x[i] = cx;
+        out.clip_y[i] = cy;
+        out.clip_z[i] = cz;
+        out.clip_w[i] = cw;
+        out.screen_x[i] = (cx/cw + 1.0f) * half_width;
+        out.screen_y[i] = (cy/cw + 1.0f) * half_height;
+    }
+}
+
+static void classify_scalar(const Vector4& p, float thickness, const VertexArrays& in, uint8_t* out_sides, size_t first) {
+    for(size_t i = first; i < in.count; i++) {
+        float distance = p.x*in.x[i] + p.y*in.y[i] + p.z*in.z[i] + p.w;
+        out_sides[i] = (distance > thickness ? PLANE_FRONT : 0) | (distance < -thickness ? PLANE_BEHIND : 0);
+    }
+}
+
+#ifdef TRANSFORM_X86
+// 4 verticies per step, sse2 is always there on x86-64
+// same operation order as scalar kernel so results match exactly
+__attribute__((target("sse2")))
+static size_t transform_sse(const Matrix& m, const VertexArrays& in, const TransformedArrays& out) {
+    const __m128 half_width = _mm_set1_ps(screenWidth/2.0f);
+    const __m128 half_height = _mm_set1_ps(screenHeight/2.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for(; i + 4 <= in.count; i += 4) {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+        __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m0), x), _mm_mul_ps(_mm_set1_ps(m.m4), y)),
+            _mm_mul_ps(_mm_set1_ps(m.m8), z)), _mm_set1_ps(m.m12));
+        __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m1), x), _mm_mul_ps(_mm_set1_ps(m.m5), y)),
+            _mm_mul_ps(_mm_set1_ps(m.m9), z)), _mm_set1_ps(m.m13));
+        __m128 cz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m2), x), _mm_mul_ps(_mm_set1_ps(m.m6), y)),
+            _mm_mul_ps(_mm_set1_ps(m.m10), z)), _mm_set1_ps(m.m14));
+        __m128 cw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m3), x), _mm_mul_ps(_mm_set1_ps(m.m7), y)),
+            _mm_mul_ps(_mm_set1_ps(m.m11), z)), _mm_set1_ps(m.m15));
+        _mm_storeu_ps(out.clip_x + i, cx);
+        _mm_storeu_ps(out.clip_y + i, cy);
+        _mm_storeu_ps(out.clip_z + i, cz);
+        _mm_storeu_ps(out.clip_w + i, cw);
+        _mm_storeu_ps(out.screen_x + i, _mm_mul_ps(_mm_add_ps(_mm_div_ps(cx, cw), one), half_width));
+        _mm_storeu_ps(out.screen_y + i, _mm_mul_ps(_mm_add_ps(_mm_div_ps(cy, cw), one), half_height));
+    }
+
+    return i;
+}
+
+// 8 verticies per step, compiled for avx without raising the baseline of the build
+__attribute__((target("avx")))
+static size_t transform_avx(const Matrix& m, const VertexArrays& in, const TransformedArrays& out) {
+    const __m256 half_width = _mm256_set1_ps(screenWidth/2.0f);
+    const __m256 half_height = _mm256_set1_ps(screenHeight/2.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for(; i + 8 <= in.count; i += 8) {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+        __m256 cx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.m0), x), _mm256_mul_ps(_mm256_set1_ps(m.m4), y)),
+            _mm256_mul_ps(_mm256_set1_ps(m.m8), z)), _mm256_set1_ps(m.m12));
+        __m256 cy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.m1), x), _mm256_mul_ps(_mm256_set1_ps(m.m5), y)),
+            _mm256_mul_ps(_mm256_set1_ps(m.m9), z)), _mm256_set1_ps(m.m13));
+        __m256 cz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.m2), x), _mm256_mul_ps(_mm256_set1_ps(m.m6), y)),
+            _mm256_mul_ps(_mm256_set1_ps(m.m10), z)), _mm256_set1_ps(m.m14));
+        __m256 cw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.m3), x), _mm256_mul_ps(_mm256_set1_ps(m.m7), y)),
+            _mm256_mul_ps(_mm256_set1_ps(m.m11), z)), _mm256_set1_ps(m.m15));
+        _mm256_storeu_ps(out.clip_x + i, cx);
+        _mm256_storeu_ps(out.clip_y + i, cy);
+        _mm256_storeu_ps(out.clip_z + i, cz);
+        _mm256_storeu_ps(out.clip_w + i, cw);
+        _mm256_storeu_ps(out.screen_x + i, _mm256_mul_ps(_mm256_add_ps(_mm256_div_ps(cx, cw), one), half_width));
+        _mm256_storeu_ps(out.screen_y + i, _mm256_mul_ps(_mm256_add_ps(_mm256_div_ps(cy, cw), one), half_height));
+    }
+
+    return i;
+}
+
+// comparison masks are cut down to side flags and packed to one byte per vertex
+__attribute__((target("sse2")))
+static size_t classify_sse(const Vector4& p, float thickness, const VertexArrays& in, uint8_t* out_sides) {
+    const __m128 front_limit = _mm_set1_ps(thickness);
+    const __m128 behind_limit = _mm_set1_ps(-thickness);
+    const __m128i front_flag = _mm_set1_epi32(PLANE_FRONT);
+    const __m128i behind_flag = _mm_set1_epi32(PLANE_BEHIND);
+    size_t i = 0;
+    for(; i + 4 <= in.count; i += 4) {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), x), _mm_mul_ps(_mm_set1_ps(p.y), y)),
+            _mm_mul_ps(_mm_set1_ps(p.z), z)), _mm_set1_ps(p.w));
+        __m128i sides = _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(distance, front_limit)), front_flag),
+            _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(distance, behind_limit)), behind_flag));
+        sides = _mm_packs_epi32(sides, sides);
+        sides = _mm_packus_epi16(sides, sides);
+        int packed = _mm_cvtsi128_si32(sides);
+        memcpy(out_sides + i, &packed, 4);
+    }
+
+    return i;
+}
+
+// 8 verticies per step, packing uses sse2 on both halves since avx has no integer packs
+__attribute__((target("avx")))
+static size_t classify_avx(const Vector4& p, float thickness, const VertexArrays& in, uint8_t* out_sides) {
+    const __m256 front_limit = _mm256_set1_ps(thickness);
+    const __m256 behind_limit = _mm256_set1_ps(-thickness);
+    const __m256 front_flag = _mm256_castsi256_ps(_mm256_set1_epi32(PLANE_FRONT));
+    const __m256 behind_flag = _mm256_castsi256_ps(_mm256_set1_epi32(PLANE_BEHIND));
+    size_t i = 0;
+    for(; i + 8 <= in.count; i += 8) {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), x), _mm256_mul_ps(_mm256_set1_ps(p.y), y)),
+            _mm256_mul_ps(_mm256_set1_ps(p.z), z)), _mm256_set1_ps(p.w));
+        __m256 sides = _mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(distance, front_limit, _CMP_GT_OQ), front_flag),
+            _mm256_and_ps(_mm256_cmp_ps(distance, behind_limit, _CMP_LT_OQ), behind_flag));
+        __m128i low = _mm_castps_si128(_mm256_castps256_ps128(sides));
+        __m128i high = _mm_castps_si128(_mm256_extractf128_ps(sides, 1));
+        __m128i packed = _mm_packs_epi32(low, high);
+        packed = _mm_packus_epi16(packed, packed);
+        _mm_storel_epi64((__m128i*)(out_sides + i), packed);
+    }
+
+    return i;
+}
+#endif
+
+// fastest kernel supported by this cpu, checked once
+TransformKernel get_transform_kernel() {
+#ifdef TRANSFORM_X86
+    static const TransformKernel kernel = __builtin_cpu_supports("avx") ? TransformKernel::AVX :
+        __builtin_cpu_supports("sse2") ? TransformKernel::SSE : TransformKernel::SCALAR;
+    return kernel;
+#else
+    return TransformKernel::SCALAR;
+#endif
+}
+
+const char* transform_kernel_name(TransformKernel kernel) {
+    switch(kernel) {
+        case TransformKernel::SCALAR: return "scalar";
+        case TransformKernel::SSE: return "sse";
+        case TransformKernel::AVX: return "avx";
+    }
+    return "unknown";
+}
+
+// multiply by mat, then perspective divide and viewport mapping for screen position
+void transform_verticies(const Matrix& mat, const VertexArrays& in, const TransformedArrays& out) {
+    transform_verticies(mat, in, out, get_transform_kernel());
+}
+
+void transform_verticies(const Matrix& mat, const VertexArrays& in, const TransformedArrays& out, TransformKernel kernel) {
+    size_t done = 0;
+#ifdef TRANSFORM_X86
+    if(kernel == TransformKernel::AVX)
+        done = transform_avx(mat, in, out);
+    else if(kernel == TransformKernel::SSE)
+        done = transform_sse(mat, in, out);
+#endif
+    // tail and scalar only cpus
+    transform_scalar(mat, in, out, done);
+}
+
+// side flags of every vertex against one plane
+void classify_verticies(const Vector4& plane, float thickness, const VertexArrays& in, uint8_t* out_sides) {
+    classify_verticies(plane, thickness, in, out_sides, get_transform_kernel());
+}
+
+void classify_verticies(const Vector4& plane, float thickness, const VertexArrays& in, uint8_t* out_sides, TransformKernel kernel) {
+    size_t done = 0;
+#ifdef TRANSFORM_X86
+    if(kernel == TransformKernel::AVX)
+        done = classify_avx(plane, thickness, in, out_sides);
+    else if(kernel == TransformKernel::SSE)
+        done = classify_sse(plane, thickness, in, out_sides);
+#endif
+    // tail and scalar only cpus
+    classify_scalar(plane, thickness, in, out_sides, done);
+}
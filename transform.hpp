@@ -0,0 +1,83 @@
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+
+#include "include/raylib.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class TransformKernel {
+    SCALAR,
+    SSE,
+    AVX
+};
+
+// world space verticies as separate x, y, z arrays
+struct VertexArrays {
+    const float* x;
+    const float* y;
+    const float* z;
+    size_t count;
+};
+
+// clip space position, before divide, and screen position of every vertex
+struct TransformedArrays {
+    float* clip_x;
+    float* clip_y;
+    float* clip_z;
+    float* clip_w;
+    float* screen_x;
+    float* screen_y;
+};
+
+// reusable storage for one frame of verticies
+class VertexBuffer {
+public:
+    std::vector<float> x, y, z;
+    std::vector<float> clip_x, clip_y, clip_z, clip_w;
+    std::vector<float> screen_x, screen_y;
+
+    void resize(size_t count);
+
+    // transformed arrays only, for input that lives elsewhere
+    void resize_output(size_t count);
+
+    VertexArrays input() const;
+
+    TransformedArrays output();
+
+    // is vertex i between near and far planes
+    bool in_depth_range(size_t i) const;
+
+    Vector4 clip(size_t i) const;
+
+    Vector2 screen(size_t i) const;
+
+    // ndc z, for depth tested targets
+    float depth(size_t i) const;
+
+    // bytes of input and transformed arrays
+    size_t memory_usage() const;
+};
+
+// fastest kernel supported by this cpu, checked once
+TransformKernel get_transform_kernel();
+
+const char* transform_kernel_name(TransformKernel kernel);
+
+// multiply by mat, then perspective divide and viewport mapping for screen position
+void transform_verticies(const Matrix& mat, const VertexArrays& in, const TransformedArrays& out);
+
+void transform_verticies(const Matrix& mat, const VertexArrays& in, const TransformedArrays& out, TransformKernel kernel);
+
+// side flags of classify_verticies, vertex within thickness of plane has neither
+const uint8_t PLANE_FRONT = 1;
+const uint8_t PLANE_BEHIND = 2;
+
+// side flags of every vertex against one plane
+// plane should be normalized, thickness is then a distance
+void classify_verticies(const Vector4& plane, float thickness, const VertexArrays& in, uint8_t* out_sides);
+
+void classify_verticies(const Vector4& plane, float thickness, const VertexArrays& in, uint8_t* out_sides, TransformKernel kernel);
+
+#endif
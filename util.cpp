@@ -4,58 +4,144 @@
 #include <cstdlib>
 #include <cstdio>
 
+Frustum::Frustum() {
+    for(auto& plane : planes)
+        plane = (Vector4){0.0f, 0.0f, 0.0f, 0.0f};
+}
+
+Frustum::Frustum(const Matrix& mat) {
+    Vector4 row0 = {mat.m0, mat.m4, mat.m8, mat.m12};
+    Vector4 row1 = {mat.m1, mat.m5, mat.m9, mat.m13};
+    Vector4 row2 = {mat.m2, mat.m6, mat.m10, mat.m14};
+    Vector4 row3 = {mat.m3, mat.m7, mat.m11, mat.m15};
+
+    planes[0] = (Vector4){row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w};
+    planes[1] = (Vector4){row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w};
+    planes[2] = (Vector4){row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w};
+    planes[3] = (Vector4){row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w};
+    planes[4] = (Vector4){row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w};
+    planes[5] = (Vector4){row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w};
+}
+
+// is box fully outside of any plane
+bool Frustum::box_outside(Vector3 box_min, Vector3 box_max) const {
+    for(const auto& plane : planes) {
+        // box corner furthest along plane normal
+        Vector3 corner = {
+            plane.x >= 0 ? box_max.x : box_min.x,
+            plane.y >= 0 ? box_max.y : box_min.y,
+            plane.z >= 0 ? box_max.z : box_min.z
+        };
+        if(point_in_plane_equasion(corner, plane) < 0)
+            return true;
+    }
+
+    return false;
+}
+
 Vcam::Vcam(Vector3 camera_pos, Vector3 camera_up, Vector3 camera_target, Matrix projection_matrix) {
     this->camera_up = camera_up;
     this->camera_pos = camera_pos;
     this->camera_target = camera_target;
     this->camera_right = Vector3CrossProduct(camera_target, camera_up);
     this->projection_matrix = projection_matrix;
+    update_view_matrix();
+}
+
+void Vcam::update_view_matrix() {
+    view_matrix = MatrixLookAt(camera_pos, Vector3Add(camera_pos, camera_target), camera_up);
+    view_project_matrix = MatrixMultiply(view_matrix, projection_matrix);
+    frustum = Frustum(view_project_matrix);
 }
 
 void Vcam::move_forward() {
     camera_pos = Vector3Add(camera_pos, Vector3Scale(Vector3Normalize(camera_target), 0.1));
+    update_view_matrix();
 }
 
 void Vcam::move_backward() {
     camera_pos = Vector3Subtract(camera_pos, Vector3Scale(Vector3Normalize(camera_target), 0.1));
+    update_view_matrix();
 }
 
 void Vcam::move_left() {
     camera_pos = Vector3Subtract(camera_pos, Vector3Scale(Vector3Normalize(camera_right), 0.1));
+    update_view_matrix();
 }
 
 void Vcam::move_right() {
     camera_pos = Vector3Add(camera_pos, Vector3Scale(Vector3Normalize(camera_right), 0.1));
+    update_view_matrix();
 }
 
 void Vcam::move_up() {
     camera_pos = Vector3Add(camera_pos, Vector3Scale((Vector3){0.0f, 1.0f, 0.0f}, 0.1f));
+    update_view_matrix();
 }
 
 void Vcam::move_down() {
     camera_pos = Vector3Subtract(camera_pos, Vector3Scale((Vector3){0.0f, 1.0f, 0.0f}, 0.1f));
+    update_view_matrix();
 }
 
 void Vcam::rotate_up(Quaternion q) {
     camera_up = Vector3RotateByQuaternion(camera_up, q);
+    update_view_matrix();
 }
 
 void Vcam::rotate_right(Quaternion q) {
     camera_right = Vector3RotateByQuaternion(camera_right, q);
+    update_view_matrix();
 }
 
 void Vcam::rotate_target(Quaternion q) {
     camera_target = Vector3RotateByQuaternion(camera_target, q);
+    update_view_matrix();
+}
+
+void Vcam::yaw(float angle) {
+    Quaternion q = QuaternionFromAxisAngle((Vector3){0.0f, 1.0f, 0.0f}, angle);
+    camera_target = Vector3RotateByQuaternion(camera_target, q);
+    camera_right = Vector3RotateByQuaternion(camera_right, q);
+    camera_up = Vector3RotateByQuaternion(camera_up, q);
+    update_view_matrix();
+}
+
+void Vcam::pitch(float angle) {
+    Quaternion q = QuaternionFromAxisAngle(camera_right, angle);
+    camera_target = Vector3RotateByQuaternion(camera_target, q);
+    camera_up = Vector3RotateByQuaternion(camera_up, q);
+    update_view_matrix();
+}
+
+void Vcam::roll(float angle) {
+    Quaternion q = QuaternionFromAxisAngle(camera_target, angle);
+    camera_right = Vector3RotateByQuaternion(camera_right, q);
+    camera_up = Vector3RotateByQuaternion(camera_up, q);
+    update_view_matrix();
 }
 
 void Vcam::set_projection_mat(Matrix projection_mat) {
     this->projection_matrix = projection_mat;
+    update_view_matrix();
 }
 
 Matrix Vcam::get_project_mat() const {
     return projection_matrix;
 }
 
+Matrix Vcam::get_view_mat() const {
+    return view_matrix;
+}
+
+Matrix Vcam::get_view_project_mat() const {
+    return view_project_matrix;
+}
+
+Frustum Vcam::get_frustum() const {
+    return frustum;
+}
+
 Vector3 Vcam::get_up() const {
     return camera_up;
 }
@@ -91,10 +177,15 @@ Triangle::Triangle(Vector3 v1, Vector3 v2, Vector3 v3, Color color) {
 // does triangle plane cross given triangle
 // 1 if in front, 0 if they cross, -1 if behind
 int Triangle::plane_cross_triangle(Triangle* triangle) const {
-    Vector4 plane = to_plane();
-    float sign_p1 = point_in_plane_equasion(triangle->verticies[0], plane);
-    float sign_p2 = point_in_plane_equasion(triangle->verticies[1], plane);
-    float sign_p3 = point_in_plane_equasion(triangle->verticies[2], plane);
+    return triangle->plane_side(to_plane());
+}
+
+// which side of plane is triangle on
+// 1 if in front, 0 if it crosses, -1 if behind
+int Triangle::plane_side(const Vector4& plane) const {
+    float sign_p1 = point_in_plane_equasion(verticies[0], plane);
+    float sign_p2 = point_in_plane_equasion(verticies[1], plane);
+    float sign_p3 = point_in_plane_equasion(verticies[2], plane);
     if(sign_p1 == 0 && sign_p2 == 0 && sign_p3 == 0)
         return 1;
     else if((sign_p1 >= 0 && sign_p2 >= 0 && sign_p3 >= 0))
@@ -125,23 +216,16 @@ void Triangle::multiply_by_matrix(Matrix& mat) {
         v = multiply_mv(mat, v);
 }
 
-void Triangle::draw(const Vcam& camera) const {
+void Triangle::draw(const Vcam& camera, TriangleBatch& batch) const {
     if(!this->visible)
         return;
 
-    Vector3 projected_verticies[3] = {0};
-    Vector2 projected_screen_verticies[3] = {0};
-    
-    for(int i = 0; i < 3; i++) {
-        projected_verticies[i] = multiply_mv(camera.get_project_mat(), verticies[i]);
-        projected_screen_verticies[i] = get_2d_screen_vec(projected_verticies[i]);
-    }
+    Vector4 clip_verticies[3];
+    Matrix view_project_mat = camera.get_view_project_mat();
+    for(int i = 0; i < 3; i++)
+        clip_verticies[i] = multiply_mv4(view_project_mat, verticies[i]);
 
-    // double draw to omit clock wise triangles only
-    if(z_in_range(projected_verticies[0].z) && z_in_range(projected_verticies[1].z && z_in_range(projected_verticies[2].z)))
-        DrawTriangle(projected_screen_verticies[0], projected_screen_verticies[1], projected_screen_verticies[2], color);
-    if(z_in_range(projected_verticies[2].z) && z_in_range(projected_verticies[1].z && z_in_range(projected_verticies[0].z)))
-        DrawTriangle(projected_screen_verticies[2], projected_screen_verticies[1], projected_screen_verticies[0], color);
+    draw_clipped_triangle(clip_verticies, color, batch);
 }
 
 bool Triangle::is_visible() const {
@@ -154,6 +238,17 @@ Triangle Triangle::copy() const {
 
 Vector3 multiply_mv(const Matrix &mat, const Vector3 &vec) {
     Vector3 ret;
+    Vector4 result = multiply_mv4(mat, vec);
+
+    ret.x = result.x/result.w;
+    ret.y = result.y/result.w;
+    ret.z = result.z/result.w;
+
+    return ret;
+}
+
+// clip space result, before perspective divide
+Vector4 multiply_mv4(const Matrix &mat, const Vector3 &vec) {
     Vector4 result;
 
     result.x = mat.m0*vec.x + mat.m4*vec.y + mat.m8*vec.z + mat.m12;
@@ -161,20 +256,80 @@ Vector3 multiply_mv(const Matrix &mat, const Vector3 &vec) {
     result.z = mat.m2*vec.x + mat.m6*vec.y + mat.m10*vec.z + mat.m14;
     result.w = mat.m3*vec.x + mat.m7*vec.y + mat.m11*vec.z + mat.m15;
 
-    ret.x = result.x/result.w;
-    ret.y = result.y/result.w;
-    ret.z = result.z/result.w;
-
-    return ret;
+    return result;
 }
 
+// ndc to screen coordinates
 Vector2 get_2d_screen_vec(const Vector3& vec) {
     return (Vector2){
-        (vec.x/vec.z + 1.0f) * screenWidth/2.0f, 
-        (vec.y/vec.z + 1.0f) * screenHeight/2.0f
+        (vec.x + 1.0f) * screenWidth/2.0f, 
+        (vec.y + 1.0f) * screenHeight/2.0f
     };
 }
 
+// sutherland-hodgman against one plane, inside when dot(plane, v) >= 0
+static int clip_polygon(const Vector4* in, int count, Vector4* out, Vector4 plane) {
+    int out_count = 0;
+    for(int i = 0; i < count; i++) {
+        const Vector4& current = in[i];
+        const Vector4& next = in[(i + 1) % count];
+        float d_current = plane.x*current.x + plane.y*current.y + plane.z*current.z + plane.w*current.w;
+        float d_next = plane.x*next.x + plane.y*next.y + plane.z*next.z + plane.w*next.w;
+
+        if(d_current >= 0)
+            out[out_count++] = current;
+        if((d_current >= 0) != (d_next >= 0)) {
+            float t = d_current / (d_current - d_next);
+            out[out_count++] = (Vector4){
+                current.x + t * (next.x - current.x),
+                current.y + t * (next.y - current.y),
+                current.z + t * (next.z - current.z),
+                current.w + t * (next.w - current.w)
+            };
+        }
+    }
+
+    return out_count;
+}
+
+// clip polygon to near and far planes (-w <= z <= w), returns new vertex count
+// out needs room for count + 2 verticies
+int clip_near_far(const Vector4* in, int count, Vector4* out) {
+    Vector4 near_clipped[8];
+    int near_count = clip_polygon(in, count, near_clipped, (Vector4){0.0f, 0.0f, 1.0f, 1.0f});
+    if(near_count < 3)
+        return 0;
+    int far_count = clip_polygon(near_clipped, near_count, out, (Vector4){0.0f, 0.0f, -1.0f, 1.0f});
+    return far_count < 3 ? 0 : far_count;
+}
+
+// clip triangle given in clip space and add what is left to batch
+// returns number of triangles added, 0 if it was fully outside
+// with depth keeps ndc z of verticies for depth tested targets
+int draw_clipped_triangle(const Vector4 clip_verticies[3], Color color, TriangleBatch& batch, bool with_depth) {
+    Vector4 clipped[5];
+    int count = clip_near_far(clip_verticies, 3, clipped);
+
+    Vector3 screen_verticies[5];
+    for(int i = 0; i < count; i++) {
+        const Vector4& v = clipped[i];
+        Vector2 screen = get_2d_screen_vec((Vector3){v.x/v.w, v.y/v.w, v.z/v.w});
+        screen_verticies[i] = (Vector3){screen.x, screen.y, v.z/v.w};
+    }
+
+    // clipped polygon is convex, draw it as a fan
+    for(int i = 1; i + 1 < count; i++) {
+        const Vector3& v1 = screen_verticies[0];
+        const Vector3& v2 = screen_verticies[i];
+        const Vector3& v3 = screen_verticies[i + 1];
+        if(with_depth)
+            batch.add(v1, v2, v3, color);
+        else
+            batch.add((Vector2){v1.x, v1.y}, (Vector2){v2.x, v2.y}, (Vector2){v3.x, v3.y}, color);
+    }
+    return count > 2 ? count - 2 : 0;
+}
+
 Vector3 get_random_vector(float min, float max) {
     float x = (float)rand()/(float)RAND_MAX * (max - min) + min;
     float y = (float)rand()/(float)RAND_MAX * (max - min) + min;
@@ -197,10 +352,6 @@ void print_matrix(const Matrix& mat) {
     printf("\n");
 }
 
-bool z_in_range(float z) {
-    return z > 0 && z <= 1;
-}
-
 float point_in_plane_equasion(Vector3 point, Vector4 plane) {
     return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
 }
@@ -2,10 +2,25 @@
 #define UTIL_HPP
 
 #include "include/raylib.h"
+#include "batch.hpp"
 
 const int screenWidth = 1500;
 const int screenHeight = 900;
 
+class Frustum {
+public:
+    // left, right, bottom, top, near, far, points inside give >= 0
+    Vector4 planes[6];
+
+    Frustum();
+
+    // planes from world to clip space matrix
+    Frustum(const Matrix& view_project_mat);
+
+    // is box fully outside of any plane
+    bool box_outside(Vector3 box_min, Vector3 box_max) const;
+};
+
 class Vcam {
 private:
     Vector3 camera_up;
@@ -13,6 +28,12 @@ private:
     Vector3 camera_target;
     Vector3 camera_right;
     Matrix projection_matrix;
+    Matrix view_matrix;
+    Matrix view_project_matrix;
+    Frustum frustum;
+
+    // rebuild view matrix from camera position and orientation
+    void update_view_matrix();
 
 public:
     Vcam(Vector3 camera_pos, Vector3 camera_up, Vector3 camera_target, Matrix projection_matrix);
@@ -35,10 +56,26 @@ public:
 
     void rotate_right(Quaternion q);
 
+    // rotate around world y axis
+    void yaw(float angle);
+
+    // rotate around camera right vector
+    void pitch(float angle);
+
+    // rotate around camera target vector
+    void roll(float angle);
+
     void set_projection_mat(Matrix projection_mat);
 
     Matrix get_project_mat() const;
 
+    Matrix get_view_mat() const;
+
+    // view and projection combined, world space to clip space
+    Matrix get_view_project_mat() const;
+
+    Frustum get_frustum() const;
+
     Vector3 get_up() const;
 
     Vector3 get_pos() const;
@@ -62,13 +99,17 @@ public:
     // 1 if in front, 0 if they cross, -1 if behind
     int plane_cross_triangle(Triangle* triangle) const;
 
+    // which side of plane is triangle on
+    // 1 if in front, 0 if it crosses, -1 if behind
+    int plane_side(const Vector4& plane) const;
+
     Vector4 to_plane() const;
 
     void rotate(Quaternion& q);
 
     void multiply_by_matrix(Matrix& mat);
 
-    void draw(const Vcam& camera) const;
+    void draw(const Vcam& camera, TriangleBatch& batch) const;
 
     bool is_visible() const;
 
@@ -77,16 +118,27 @@ public:
 
 Vector3 multiply_mv(const Matrix& mat, const Vector3& vec);
 
+// clip space result, before perspective divide
+Vector4 multiply_mv4(const Matrix& mat, const Vector3& vec);
+
+// ndc to screen coordinates
 Vector2 get_2d_screen_vec(const Vector3& vec);
 
+// clip polygon to near and far planes (-w <= z <= w), returns new vertex count
+// out needs room for count + 2 verticies
+int clip_near_far(const Vector4* in, int count, Vector4* out);
+
+// clip triangle given in clip space and add what is left to batch
+// returns number of triangles added, 0 if it was fully outside
+// with depth keeps ndc z of verticies for depth tested targets
+int draw_clipped_triangle(const Vector4 clip_verticies[3], Color color, TriangleBatch& batch, bool with_depth = false);
+
 Vector3 get_random_vector(float min, float max);
 
 Color get_random_color();
 
 void print_matrix(Matrix mat);
 
-bool z_in_range(float z);
-
 float point_in_plane_equasion(Vector3 point, Vector4 plane);
 
 Matrix get_project_matrix(int screenWidth, int screenHeight, float fovy, float zNear, float zFar);
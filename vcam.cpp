@@ -1,11 +1,19 @@
 #include "include/raylib.h"
 #include "include/raymath.h"
 #include "include/rlgl.h"
+#include <algorithm>
 #include <vector>
+#include <cstdio>
+#include <cstring>
 
 #include "util.hpp"
 #include "cube.hpp"
 #include "bsp.hpp"
+#include "render.hpp"
+#include "camera_path.hpp"
+#include "counters.hpp"
+#include "loader.hpp"
+#include "lod.hpp"
 
 std::vector<Cube> init_cubes() {
     return std::vector<Cube> {
@@ -47,16 +55,25 @@ std::vector<Triangle*> init_triangles() {
     };
 }
 
-int main(void) {
+// copies of LOD model to the right of cube grid, each further away than the one before
+const int LOD_COPIES = 6;
+// newest frames of counters kept for counters.csv and counters.json, a minute at 60 fps
+const size_t COUNTERS_HISTORY_FRAMES = 3600;
+
+// usage: vcam [scene.bsp|-] [model.obj|model.ply], without tree file or with - the cube scene is built
+// model is scaled to unit radius, placed LOD_COPIES times and drawn with levels of detail
+int main(int argc, char** argv) {
     SetConfigFlags(FLAG_MSAA_4X_HINT); // Multisampling 4x
     // Initialization
     //--------------------------------------------------------------------------------------
-    std::vector<Triangle*> triangles = init_triangles();
-    std::vector<Cube> cubes = init_cubes();
-    for(auto& cube : cubes) {
-        auto cube_triangles = cube.get_triangles();
-        triangles.insert(triangles.end(), cube_triangles.begin(), cube_triangles.end());
+    Mesh scene_mesh;
+    for(auto& t : init_triangles()) {
+        scene_mesh.add_triangle(*t);
+        delete t;
     }
+    std::vector<Cube> cubes = init_cubes();
+    for(auto& cube : cubes)
+        scene_mesh.append(cube.get_mesh());
 
     // if index == -1 all triangles are visible
     int invisible_indx = -1;
@@ -73,22 +90,59 @@ int main(void) {
     Vcam camera = Vcam(camera_pos, camera_up, camera_target, project_mat);
     float mouse_sensitivity = 0.001f;
 
-    Matrix move_right = MatrixIdentity();
-    move_right.m12 = -0.1f;
-    Matrix move_left = MatrixIdentity();
-    move_left.m12 = 0.1f;
-    Matrix move_up = MatrixIdentity();
-    move_up.m13 = -0.1f;
-    Matrix move_down = MatrixIdentity();
-    move_down.m13 = 0.1f;
-    Matrix move_forward = MatrixIdentity();
-    move_forward.m14 = 0.1f;
-    Matrix move_backward = MatrixIdentity();
-    move_backward.m14 = -0.1f;
-
-    BSPTree bsp_tree = BSPTree(triangles);
+    BSPTree bsp_tree;
+    if(argc < 2 || strcmp(argv[1], "-") == 0)
+        bsp_tree = BSPTree(scene_mesh, SplitterStrategy::AXIS_ALIGNED);
+    else if(!bsp_tree.load(argv[1])) {
+        fprintf(stderr, "cannot load %s\n", argv[1]);
+        return 1;
+    }
+    BSPStats bsp_stats = bsp_tree.get_stats();
+    printf("BSP build: %.3f ms, %d nodes, depth %d, %d splits, %d verticies\n",
+        bsp_stats.build_time * 1000.0, bsp_stats.node_count, bsp_stats.depth, bsp_stats.split_count, bsp_stats.vertex_count);
+    
+    // orbits between grid cubes, drawn with the tree without rebuilding it
+    Cube moving_cube = Cube({0.0f, 2.0f, -11.5f}, 1.0f);
+    Vector3 orbit_center = (Vector3){0.0f, 2.0f, -14.0f};
+    Matrix orbit_step = MatrixMultiply(MatrixMultiply(
+        MatrixTranslate(-orbit_center.x, -orbit_center.y, -orbit_center.z), MatrixRotateY(0.01f)),
+        MatrixTranslate(orbit_center.x, orbit_center.y, orbit_center.z));
+    size_t moving_cube_id = bsp_tree.add_dynamic_mesh(moving_cube.get_mesh());
+    bool moving_cube_paused = false;
+
+    // level of every copy follows its screen size, copy is re-added only when its level changes
+    LODMesh lod_model;
+    std::vector<Vector3> lod_offsets;
+    std::vector<size_t> lod_ids;
+    std::vector<int> lod_levels;
+    bool lod_enabled = true;
+    if(argc > 2) {
+        Mesh model;
+        if(!load_mesh(argv[2], &model)) {
+            fprintf(stderr, "cannot load %s\n", argv[2]);
+            return 1;
+        }
+        LODMesh unscaled = LODMesh(model, 1);
+        for(auto& v : model.verticies)
+            v = Vector3Scale(Vector3Subtract(v, unscaled.get_center()), 1.0f / std::max(unscaled.get_radius(), 1e-6f));
+        lod_model = LODMesh(model);
+        printf("LOD build: %.3f ms, %d levels, %zu to %zu triangles\n", lod_model.get_build_time() * 1000.0, lod_model.level_count(),
+            lod_model.get_level(0).triangles.size(), lod_model.get_level(lod_model.level_count() - 1).triangles.size());
+        for(int i = 0; i < LOD_COPIES; i++) {
+            lod_offsets.push_back((Vector3){8.0f, 0.0f, -6.0f - 12.0f * i});
+            lod_ids.push_back(bsp_tree.add_dynamic_mesh(lod_model.get_level(0, lod_offsets.back())));
+            lod_levels.push_back(0);
+        }
+    }
+
+    // camera of every frame while recording, for frame_bench
+    std::vector<CameraKey> recorded_path;
+    bool recording = false;
+    bool show_counters = false;
+    counters_set_history_limit(COUNTERS_HISTORY_FRAMES);
     
     InitWindow(screenWidth, screenHeight, "Virtual camera");
+    WindowTarget window_target;
 
     SetTargetFPS(60);
     DisableCursor();
@@ -98,167 +152,132 @@ int main(void) {
         // Update
         //----------------------------------------------------------------------------------
         
-        Vector2 mouse_delta = GetMouseDelta();
-        if(mouse_delta.x != 0 || mouse_delta.y != 0) {
-            Quaternion q_yaw_rot = QuaternionFromAxisAngle(camera.get_up(), mouse_delta.x * mouse_sensitivity);
-            Quaternion q_yaw_camera = QuaternionFromAxisAngle({0.0f, 1.0f, 0.0f}, -mouse_delta.x * mouse_sensitivity);
-
-            Quaternion q_pitch_rot = QuaternionFromAxisAngle({1.0, 0.0, 0.0}, mouse_delta.y * mouse_sensitivity);
-            Quaternion q_pitch_camera = QuaternionFromAxisAngle(camera.get_right(), -mouse_delta.y * mouse_sensitivity);
-            camera.rotate_target(q_yaw_camera);
-            camera.rotate_right(q_yaw_camera);
-
-            camera.rotate_target(q_pitch_camera);
-            camera.rotate_up(q_pitch_rot);
-
-            for(auto& t : triangles) {
-                t->rotate(q_yaw_rot);
-                t->rotate(q_pitch_rot);
+        {
+            COUNTER_SCOPE(UPDATE);
+
+            Vector2 mouse_delta = GetMouseDelta();
+            if(mouse_delta.x != 0 || mouse_delta.y != 0) {
+                camera.yaw(-mouse_delta.x * mouse_sensitivity);
+                camera.pitch(-mouse_delta.y * mouse_sensitivity);
             }
-        }
 
-        if(IsKeyDown(KEY_H)) {
-            Quaternion q_yaw_rot = QuaternionFromAxisAngle(camera.get_up(), -7.0f * mouse_sensitivity);
-            Quaternion q_yaw_camera = QuaternionFromAxisAngle({0.0f, 1.0f, 0.0f}, 7.0 * mouse_sensitivity);
-            camera.rotate_target(q_yaw_camera);
-            camera.rotate_right(q_yaw_camera);
+            if(IsKeyDown(KEY_H))
+                camera.yaw(7.0f * mouse_sensitivity);
 
-            for(auto& t : triangles)
-                t->rotate(q_yaw_rot);
-        }
+            if(IsKeyDown(KEY_L))
+                camera.yaw(-7.0f * mouse_sensitivity);
 
-        if(IsKeyDown(KEY_L)) {
-            Quaternion q_yaw_rot = QuaternionFromAxisAngle(camera.get_up(), 7.0f * mouse_sensitivity);
-            Quaternion q_yaw_camera = QuaternionFromAxisAngle({0.0f, 1.0f, 0.0f}, -7.0 * mouse_sensitivity);
-            camera.rotate_target(q_yaw_camera);
-            camera.rotate_right(q_yaw_camera);
+            if(IsKeyDown(KEY_J))
+                camera.pitch(-7.0f * mouse_sensitivity);
 
-            for(auto& t : triangles)
-                t->rotate(q_yaw_rot);
-        }
+            if(IsKeyDown(KEY_K))
+                camera.pitch(7.0f * mouse_sensitivity);
 
-        if(IsKeyDown(KEY_J)) {
-            Quaternion q_pitch_rot = QuaternionFromAxisAngle({1.0f, 0.0f, 0.0f}, 7.0f * mouse_sensitivity);
-            Quaternion q_pitch_camera = QuaternionFromAxisAngle(camera.get_right(), -7.0f * mouse_sensitivity);
-            camera.rotate_target(q_pitch_camera);
-            camera.rotate_up(q_pitch_rot);
+            if(IsKeyDown(KEY_Q))
+                camera.roll(-10.0f * mouse_sensitivity);
 
-            for(auto& t : triangles)
-                t->rotate(q_pitch_rot);
-        }
+            if(IsKeyDown(KEY_E))
+                camera.roll(10.0f * mouse_sensitivity);
 
-        if(IsKeyDown(KEY_K)) {
-            Quaternion q_pitch_rot = QuaternionFromAxisAngle({1.0f, 0.0f, 0.0f}, -7.0f * mouse_sensitivity);
-            Quaternion q_pitch_camera = QuaternionFromAxisAngle(camera.get_right(), 7.0f * mouse_sensitivity);
-            camera.rotate_target(q_pitch_camera);
-            camera.rotate_up(q_pitch_rot);
+            if(IsKeyDown(KEY_W))
+                camera.move_forward();
 
-            for(auto& t : triangles)
-                t->rotate(q_pitch_rot);
-        }
+            if(IsKeyDown(KEY_S))
+                camera.move_backward();
+
+            if(IsKeyDown(KEY_A))
+                camera.move_left();
 
-        if(IsKeyDown(KEY_Q)) {
-            Quaternion q_roll_rot = QuaternionFromAxisAngle({0.0, 0.0, 1.0}, 10.0f * mouse_sensitivity);
-            Quaternion q_roll_camera = QuaternionFromAxisAngle(camera.get_target(), -10.0f * mouse_sensitivity);
-            camera.rotate_right(q_roll_camera);
-            camera.rotate_up(q_roll_camera);
+            if(IsKeyDown(KEY_D))
+                camera.move_right();
 
-            for(auto& t : triangles) {
-                t->rotate(q_roll_rot);
+            if(IsKeyDown(KEY_SPACE))
+                camera.move_up();
+
+            if(IsKeyDown(KEY_LEFT_CONTROL))
+                camera.move_down();
+
+            // wire mode
+            if(IsKeyPressed(KEY_R)) {
+                wire_mode ^= true;
+                if(wire_mode) rlEnableWireMode();
+                else rlDisableWireMode();
             }
-        }
 
-        if(IsKeyDown(KEY_E)) {
-            Quaternion q_roll_rot = QuaternionFromAxisAngle({0.0, 0.0, 1.0}, -10.0f * mouse_sensitivity);    
-            Quaternion q_roll_camera = QuaternionFromAxisAngle(camera.get_target(), 10.0f * mouse_sensitivity);    
-            camera.rotate_right(q_roll_camera);
-            camera.rotate_up(q_roll_camera);
-            
-            for(auto& t : triangles) {
-                t->rotate(q_roll_rot);
+            if(IsKeyPressed(KEY_C))
+                bsp_tree.set_frustum_culling(!bsp_tree.get_frustum_culling());
+
+            if(IsKeyPressed(KEY_B))
+                bsp_tree.set_back_face_culling(!bsp_tree.get_back_face_culling());
+
+            if(IsKeyPressed(KEY_X))
+                bsp_tree.set_pvs_culling(!bsp_tree.get_pvs_culling());
+
+            if(IsKeyPressed(KEY_V)) {
+                if(invisible_indx != -1)
+                    bsp_tree.set_triangle_visible(invisible_indx, true);
+                invisible_indx = invisible_indx == (int)bsp_tree.triangle_count() - 1 ? -1 : invisible_indx + 1;
+                if(invisible_indx != -1)
+                    bsp_tree.set_triangle_visible(invisible_indx, false);
             }
-        }
 
-        if(IsKeyDown(KEY_W)) {
-            camera.move_forward();
-            for(auto& t : triangles)
-                t->multiply_by_matrix(move_forward);
-        }
+            if(IsKeyPressed(KEY_P)) {
+                recording ^= true;
+                if(recording)
+                    recorded_path.clear();
+                else if(save_camera_path("camera_path.txt", recorded_path))
+                    printf("%zu frames written to camera_path.txt\n", recorded_path.size());
+                else
+                    fprintf(stderr, "cannot write camera_path.txt\n");
+            }
 
-        if(IsKeyDown(KEY_S)) {
-            camera.move_backward();
-            for(auto& t : triangles)
-                t->multiply_by_matrix(move_backward);
-        }
-        
-        if(IsKeyDown(KEY_A)) {
-            camera.move_left();
-            for(auto& t : triangles)
-                t->multiply_by_matrix(move_left);
-        }
-        
-        if(IsKeyDown(KEY_D)) {
-            camera.move_right();
-            for(auto& t : triangles)
-                t->multiply_by_matrix(move_right);
-        }
-        
-        if(IsKeyDown(KEY_SPACE)) {
-            camera.move_up();
-            Matrix move_up = MatrixIdentity();
-            move_up.m12 = camera.get_up().x * -0.1f;
-            move_up.m13 = camera.get_up().y * -0.1f;
-            move_up.m14 = camera.get_up().z * -0.1f;
-            for(auto& t : triangles)
-                t->multiply_by_matrix(move_up);
-        }
+            if(recording)
+                recorded_path.push_back(camera_key(camera));
 
-        if(IsKeyDown(KEY_LEFT_CONTROL)) {
-            camera.move_down();
-            Matrix move_down = MatrixIdentity();
-            move_down.m12 = camera.get_up().x * 0.1f;
-            move_down.m13 = camera.get_up().y * 0.1f;
-            move_down.m14 = camera.get_up().z * 0.1f;
-            for(auto& t : triangles)
-                t->multiply_by_matrix(move_down);
-        }
-        
-        // wire mode
-        if(IsKeyPressed(KEY_R)) {
-            wire_mode ^= true;
-            if(wire_mode) rlEnableWireMode();
-            else rlDisableWireMode();
-        }
+            if(IsKeyPressed(KEY_O))
+                show_counters ^= true;
 
-        if(IsKeyPressed(KEY_V)) {
-            if(invisible_indx != -1)
-                triangles[invisible_indx]->visible = true;
-            invisible_indx = invisible_indx == triangles.size() - 1 ? -1 : invisible_indx + 1;
-            if(invisible_indx != -1)
-                triangles[invisible_indx]->visible = false;
-        }
+            if(IsKeyPressed(KEY_M))
+                moving_cube_paused ^= true;
 
-        if(IsKeyDown(KEY_KP_ADD)) {
-            if(fovy > 1.0f)
-                fovy -= 0.1f;
-            project_mat = get_project_matrix(screenWidth, screenHeight, fovy, zNear, zFar);
-            camera.set_projection_mat(project_mat);
-        }
+            if(!moving_cube_paused) {
+                moving_cube.multiply_by_matrix(orbit_step);
+                bsp_tree.update_dynamic_mesh(moving_cube_id, moving_cube.get_mesh());
+            }
 
-        if(IsKeyDown(KEY_KP_SUBTRACT)) {
-            if(fovy < default_fovy)
-                fovy += 0.1f;
-            project_mat = get_project_matrix(screenWidth, screenHeight, fovy, zNear, zFar);
-            camera.set_projection_mat(project_mat);
+            if(IsKeyPressed(KEY_G))
+                lod_enabled ^= true;
+
+            for(size_t i = 0; i < lod_ids.size(); i++) {
+                int level = lod_enabled ? lod_model.select_level(camera, lod_offsets[i]) : 0;
+                if(level != lod_levels[i]) {
+                    bsp_tree.update_dynamic_mesh(lod_ids[i], lod_model.get_level(level, lod_offsets[i]));
+                    lod_levels[i] = level;
+                }
+            }
+
+            if(IsKeyDown(KEY_KP_ADD)) {
+                if(fovy > 1.0f)
+                    fovy -= 0.1f;
+                project_mat = get_project_matrix(screenWidth, screenHeight, fovy, zNear, zFar);
+                camera.set_projection_mat(project_mat);
+            }
+
+            if(IsKeyDown(KEY_KP_SUBTRACT)) {
+                if(fovy < default_fovy)
+                    fovy += 0.1f;
+                project_mat = get_project_matrix(screenWidth, screenHeight, fovy, zNear, zFar);
+                camera.set_projection_mat(project_mat);
+            }
         }
 
         // Draw
         //----------------------------------------------------------------------------------
         BeginDrawing();
 
-        ClearBackground(RAYWHITE);
+        window_target.clear(RAYWHITE);
         
-        bsp_tree.draw(camera);
+        bsp_tree.draw(camera, window_target);
 
         DrawCircle(screenWidth/2, screenHeight/2, 7.5f, RED);
 
@@ -285,17 +304,44 @@ int main(void) {
 
         DrawText(TextFormat("Invisible triangle index %d", invisible_indx), 20, 440, 20, BLACK);
 
+        DrawText(TextFormat("BSP nodes %d depth %d splits %d verticies %d", bsp_stats.node_count, bsp_stats.depth, bsp_stats.split_count, bsp_stats.vertex_count), 20, 480, 20, BLACK);
+        DrawText(TextFormat("BSP build time %.3f ms", bsp_stats.build_time * 1000.0), 20, 500, 20, BLACK);
+        DrawText(TextFormat("Frustum culling (C): %s", bsp_tree.get_frustum_culling() ? "on" : "off"), 20, 520, 20, BLACK);
+        DrawText(TextFormat("Back face culling (B): %s", bsp_tree.get_back_face_culling() ? "on" : "off"), 20, 540, 20, BLACK);
+        DrawText(TextFormat("PVS culling (X): %s", !bsp_tree.has_pvs() ? "no PVS" : bsp_tree.get_pvs_culling() ? "on" : "off"), 20, 560, 20, BLACK);
+        DrawText(TextFormat("Moving cube (M): %s", moving_cube_paused ? "paused" : "on"), 20, 580, 20, BLACK);
+        DrawText(TextFormat("Record camera path (P): %s, %d frames", recording ? "on" : "off", (int)recorded_path.size()), 20, 600, 20, BLACK);
+        if(!lod_ids.empty()) {
+            size_t lod_triangles = 0;
+            for(int level : lod_levels)
+                lod_triangles += lod_model.get_level(level).triangles.size();
+            DrawText(TextFormat("LOD (G): %s, %d of %d model triangles", lod_enabled ? "on" : "off",
+                (int)lod_triangles, (int)(lod_model.get_level(0).triangles.size() * lod_ids.size())), 20, 620, 20, BLACK);
+        }
+
+        // counters of previous frame, this one is still running
+        if(show_counters && !COUNTERS_ENABLED)
+            DrawText("Counters (O): not built in, use make COUNTERS=1", screenWidth - 560, 20, 20, BLACK);
+        else if(show_counters) {
+            FrameCounters counters = counters_last_frame();
+            for(int i = 0; i < (int)Counter::COUNT; i++)
+                DrawText(TextFormat("%s %lld", counter_name((Counter)i), (long long)counters.counts[i]), screenWidth - 400, 20 + 20 * i, 20, BLACK);
+            for(int i = 0; i < (int)Timer::COUNT; i++)
+                DrawText(TextFormat("%s %.3f", timer_name((Timer)i), counters.times[i] * 1000.0), screenWidth - 400, 140 + 20 * i, 20, BLACK);
+        }
+
         EndDrawing();
+        COUNTER_END_FRAME();
         //----------------------------------------------------------------------------------
     }
 
+    if(COUNTERS_ENABLED && counters_write_csv("counters.csv") && counters_write_json("counters.json"))
+        printf("last %zu frames of counters written to counters.csv and counters.json\n", counters_history().size());
+
     // De-Initialization
     //--------------------------------------------------------------------------------------
     CloseWindow();        // Close window and OpenGL context
     //--------------------------------------------------------------------------------------
-    
-    for(auto& t : triangles)
-        delete t;
 
     return 0;
 }
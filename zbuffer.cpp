@@ -0,0 +1,116 @@
+#include "include/raylib.h"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include "zbuffer.hpp"
+#include "counters.hpp"
+
+ZBufferScene::ZBufferScene(const Mesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    this->store = TriangleStore(mesh);
+    this->back_face_culling = false;
+    this->draw_stats = (ZBufferDrawStats){0, 0, 0};
+    vertex_buffer.resize_output(store.vertex_count());
+    batch.reserve(store.triangle_count());
+    this->build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ZBufferScene::draw(Vcam camera, RenderTarget& target) const {
+    COUNTER_SCOPE(SUBMISSION);
+
+    // every vertex is transformed, there is no tree to cull with
+    size_t vertex_count = store.vertex_count();
+    if(vertex_buffer.clip_x.size() < vertex_count)
+        vertex_buffer.resize_output(vertex_count);
+    VertexArrays in = (VertexArrays){store.x.data(), store.y.data(), store.z.data(), vertex_count};
+    transform_verticies(camera.get_view_project_mat(), in, vertex_buffer.output());
+    COUNTER_ADD(VERTICIES_TRANSFORMED, vertex_count);
+
+    bool depth_test = target.supports_depth_test();
+    auto add_triangle = [&](uint32_t triangle) {
+        const uint32_t* v = &store.indices[3 * triangle];
+        Color color = store.colors[triangle];
+        if(vertex_buffer.in_depth_range(v[0]) && vertex_buffer.in_depth_range(v[1]) && vertex_buffer.in_depth_range(v[2])) {
+            Vector2 s[3] = {vertex_buffer.screen(v[0]), vertex_buffer.screen(v[1]), vertex_buffer.screen(v[2])};
+            if(depth_test)
+                batch.add(
+                    (Vector3){s[0].x, s[0].y, vertex_buffer.depth(v[0])},
+                    (Vector3){s[1].x, s[1].y, vertex_buffer.depth(v[1])},
+                    (Vector3){s[2].x, s[2].y, vertex_buffer.depth(v[2])}, color);
+            else
+                batch.add(s[0], s[1], s[2], color);
+            draw_stats.drawn++;
+        }
+        else {
+            Vector4 clip_verticies[3] = {vertex_buffer.clip(v[0]), vertex_buffer.clip(v[1]), vertex_buffer.clip(v[2])};
+            int added = draw_clipped_triangle(clip_verticies, color, batch, depth_test);
+            draw_stats.clipped++;
+            draw_stats.drawn += added > 0;
+            COUNTER_ADD(TRIANGLES_CLIPPED, added > 0);
+            COUNTER_ADD(TRIANGLES_REJECTED, added == 0);
+        }
+    };
+
+    draw_stats = (ZBufferDrawStats){0, 0, 0};
+    batch.clear();
+    sorted.clear();
+    Vector3 camera_pos = camera.get_pos();
+    uint32_t triangle_count = store.triangle_count();
+    for(uint32_t i = 0; i < triangle_count; i++) {
+        if(!store.is_visible(i) || (back_face_culling && point_in_plane_equasion(camera_pos, store.planes[i]) <= 0)) {
+            draw_stats.culled++;
+            continue;
+        }
+        if(depth_test) {
+            add_triangle(i);
+            continue;
+        }
+        // clip w is distance along view direction
+        const uint32_t* v = &store.indices[3 * i];
+        float distance = vertex_buffer.clip_w[v[0]] + vertex_buffer.clip_w[v[1]] + vertex_buffer.clip_w[v[2]];
+        sorted.push_back(std::make_pair(distance, i));
+    }
+    if(!depth_test) {
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) {
+            return a.first > b.first;
+        });
+        for(const auto& entry : sorted)
+            add_triangle(entry.second);
+    }
+
+    COUNTER_ADD(TRIANGLES_SUBMITTED, batch.size());
+    target.set_depth_test(depth_test);
+    target.draw(batch);
+    target.set_depth_test(false);
+}
+
+// moved or changed triangles need no rebuild
+// planes are cached for back face culling, recompute_planes after moving verticies
+TriangleStore& ZBufferScene::get_store() {
+    return store;
+}
+
+double ZBufferScene::get_build_time() const {
+    return build_time;
+}
+
+ZBufferDrawStats ZBufferScene::get_draw_stats() const {
+    return draw_stats;
+}
+
+// bytes of triangles and per frame draw buffers
+size_t ZBufferScene::memory_usage() const {
+    return store.x.capacity() * sizeof(float) * 3 + store.indices.capacity() * sizeof(uint32_t) +
+        store.planes.capacity() * sizeof(Vector4) + store.colors.capacity() * sizeof(Color) + store.flags.capacity() +
+        vertex_buffer.memory_usage() + sorted.capacity() * sizeof(sorted[0]) +
+        batch.get_verticies().capacity() * sizeof(Vector2) + batch.get_colors().capacity() * sizeof(Color) +
+        batch.get_depths().capacity() * sizeof(float);
+}
+
+void ZBufferScene::set_back_face_culling(bool enabled) {
+    back_face_culling = enabled;
+}
+
+bool ZBufferScene::get_back_face_culling() const {
+    return back_face_culling;
+}
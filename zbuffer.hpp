@@ -0,0 +1,62 @@
+#ifndef ZBUFFER_HPP
+#define ZBUFFER_HPP
+
+#include "include/raylib.h"
+#include <cstdint>
+#include <vector>
+#include "util.hpp"
+#include "mesh.hpp"
+#include "batch.hpp"
+#include "render.hpp"
+#include "transform.hpp"
+
+// counts of last draw
+struct ZBufferDrawStats {
+    // triangles sent to render target
+    int drawn;
+    // triangles skipped by back face culling or hidden
+    int culled;
+    // triangles cut at near or far plane
+    int clipped;
+};
+
+// draws mesh without BSP ordering, occlusion comes from the target depth buffer
+// nothing to build and no splits, any change to the triangles shows in next draw
+// targets without depth test get triangles sorted far to near instead, which is not exact
+class ZBufferScene {
+private:
+    // verticies are transformed straight from its coordinate arrays
+    TriangleStore store;
+    bool back_face_culling;
+    double build_time;
+    // reused by draw, every vertex transformed once, only its output arrays are used
+    mutable VertexBuffer vertex_buffer;
+    // reused by draw, mean ndc z and triangle, for targets without depth test
+    mutable std::vector<std::pair<float, uint32_t>> sorted;
+    mutable TriangleBatch batch;
+    mutable ZBufferDrawStats draw_stats;
+
+public:
+    ZBufferScene(const Mesh& mesh);
+
+    void draw(Vcam camera, RenderTarget& target) const;
+
+    // moved or changed triangles need no rebuild
+    // planes are cached for back face culling, recompute_planes after moving verticies
+    TriangleStore& get_store();
+
+    // time to copy mesh in and compute planes, for comparing with BSP build time
+    double get_build_time() const;
+
+    ZBufferDrawStats get_draw_stats() const;
+
+    // bytes of triangles and per frame draw buffers
+    size_t memory_usage() const;
+
+    // closed mesh mode, skip triangles facing away from camera
+    void set_back_face_culling(bool enabled);
+
+    bool get_back_face_culling() const;
+};
+
+#endif